@@ -4,7 +4,1176 @@
  *  Created on: Sep 5, 2021
  *      Author: Zahwa Nasser
  */
+#include <string.h>
 #include "can.h"
+/*******************************************************************************
+ *                         Definitions                                         *
+ *******************************************************************************/
+//keeps the compiler from moving ring accesses across the index update
+#if defined(__GNUC__) || defined(__clang__)
+#define CAN_BARRIER()   __asm__ volatile ("" ::: "memory")
+#else
+#define CAN_BARRIER()
+#endif
+#define CAN_TX_KEY_EXTENDED 0x20000000
+#define CAN_TX_KEY_REMOTE   0x40000000
+#define CAN_TX_KEY_VALID    0x80000000
+#define CAN_TX_OBJECT_MASK  ((uint32)CAN_OBJECT_RANGE(CAN_TX_FIRST_OBJECT, CAN_TX_OBJECTS))
+#define CAN_FILTER_USED     0x80000000 //marks a taken slot of the extended id hash
+#ifdef CAN_TIME_US
+#define CAN_BUSOFF_TIMED    1
+#else
+//no clock for the back-off, busOffBackoff leaves bus-off at once
+#define CAN_BUSOFF_TIMED    0
+#define CAN_TIME_US()       0
+#endif
+/*******************************************************************************
+ *                         Types Declaration                                   *
+ *******************************************************************************/
+//single producer (ISR) single consumer (application) ring of received frames
+typedef struct {
+    volatile uint32 head; //written by the ISR only
+    volatile uint32 tail; //written by the application only
+    uint32 overflows; //frames dropped because the ring was full
+    can_frame frame[CAN_RX_RING_SIZE];
+}can_rxRing;
+//sent frames and status values left by the ISR for the callbacks run by
+//can_process(), single producer single consumer like can_rxRing
+typedef struct {
+    volatile uint32 sentHead; //written by the ISR only
+    volatile uint32 sentTail; //written by can_process() only
+    volatile uint32 statusHead;
+    volatile uint32 statusTail;
+    uint32 overflows; //events dropped because their ring was full
+    can_frame sent[CAN_EVENT_RING_SIZE];
+    uint32 status[CAN_EVENT_RING_SIZE];
+}can_eventRing;
+typedef struct {
+    can_frame frame;
+    uint32 key; //arbitration priority, lower is sent first
+    uint32 sequence; //keeps frames with the same id in order
+}can_txEntry;
+//binary min heap of frames waiting for a free transmit object
+typedef struct {
+    can_txEntry heap[CAN_TX_QUEUE_SIZE];
+    uint32 count;
+    uint32 sequence;
+    uint32 busyObjects; //bit n-1 set while object n holds a frame
+    can_frame inFlight[CAN_TX_OBJECTS]; //timestamp: when it was queued
+    uint64 requestedAt[CAN_TX_OBJECTS]; //when TXRQST was set
+    can_txCallback callback;
+    can_txLatency latency[CAN_TX_LATENCY_IDS];
+    uint32 latencyIds;
+}can_txQueue;
+typedef struct {
+    uint16 BIT;
+    uint8 BRPE;
+}can_bitTableEntry;
+typedef struct {
+    uint32 ID;
+    uint8 handler; //index in can_handlers
+}can_extHandlerId;
+typedef struct {
+    uint32 ID;
+    uint32 mask;
+    uint8 handler;
+}can_extHandlerMask;
+//what a message object was last loaded with by can_transmitBatch()
+typedef struct {
+    uint32 key; //id, CAN_TX_KEY_* flags, 0 when unknown
+    uint32 mask;
+    uint8 bytesNum;
+}can_txShadow;
+//bus-off state machine of a module
+typedef struct {
+    can_busOffInfo info;
+    can_busOffMode mode;
+    uint32 firstDelay;
+    uint32 maxDelay;
+    uint32 offAt; //CAN_TIME_US() of the last bus-off
+    uint32 dueAt; //end of the back-off wait
+}can_busOff;
+/*******************************************************************************
+ *                         Global Variables                                    *
+ *******************************************************************************/
+static can_rxRing can_rxRings[2];
+static can_eventRing can_events[2];
+static can_txQueue can_txQueues[2];
+//CANBIT/CANBRPE per can_clock and can_bitRateSelect, made with
+//can_computeBitTiming() for a 200 ns round trip delay and the default sample point
+static const can_bitTableEntry can_bitTable[4][4] = {
+    {   //16 MHz
+        {0x1C47, 0x0}, //125 kbit/s, BRP 8, 16 tq, sample point 87.5%
+        {0x1C43, 0x0}, //250 kbit/s, BRP 4, 16 tq, sample point 87.5%
+        {0x1C41, 0x0}, //500 kbit/s, BRP 2, 16 tq, sample point 87.5%
+        {0x1C40, 0x0}, //1000 kbit/s, BRP 1, 16 tq, sample point 87.5%
+    },
+    {   //40 MHz
+        {0x1C53, 0x0}, //125 kbit/s, BRP 20, 16 tq, sample point 87.5%
+        {0x1C49, 0x0}, //250 kbit/s, BRP 10, 16 tq, sample point 87.5%
+        {0x1C44, 0x0}, //500 kbit/s, BRP 5, 16 tq, sample point 87.5%
+        {0x2F81, 0x0}, //1000 kbit/s, BRP 2, 20 tq, sample point 85.0%
+    },
+    {   //50 MHz
+        {0x1C58, 0x0}, //125 kbit/s, BRP 25, 16 tq, sample point 87.5%
+        {0x2F89, 0x0}, //250 kbit/s, BRP 10, 20 tq, sample point 85.0%
+        {0x2F84, 0x0}, //500 kbit/s, BRP 5, 20 tq, sample point 85.0%
+        {0x1644, 0x0}, //1000 kbit/s, BRP 5, 10 tq, sample point 80.0%
+    },
+    {   //80 MHz
+        {0x1C67, 0x0}, //125 kbit/s, BRP 40, 16 tq, sample point 87.5%
+        {0x1C53, 0x0}, //250 kbit/s, BRP 20, 16 tq, sample point 87.5%
+        {0x1C49, 0x0}, //500 kbit/s, BRP 10, 16 tq, sample point 87.5%
+        {0x1C44, 0x0}, //1000 kbit/s, BRP 5, 16 tq, sample point 87.5%
+    },
+};
+static const uint32 can_tableClock[4] = {16000000, 40000000, 50000000, 80000000};
+static uint32 can_moduleClock[2]; //Fsys of the programmed timing, for can_getBitTiming()
+//bit n-1 set while message object n is allocated, the transmit queue objects are never free
+static uint32 can_objectsInUse[2] = {CAN_TX_OBJECT_MASK, CAN_TX_OBJECT_MASK};
+//objects chained by can_configureRxFifo(), and the last object (EOB) of each fifo
+static uint32 can_fifoObjects[2];
+static uint32 can_fifoEnds[2];
+static can_txShadow can_txShadows[2][32];
+static uint8 can_ifTurn[2]; //interface (0 IF1, 1 IF2) each module uses next
+static uint32 can_status[2]; //CANSTS of the last status interrupt
+static can_statusCallback can_statusCallbacks[2];
+static can_isrLoad can_isrLoads[2];
+static can_stats can_moduleStats[2];
+static uint8 can_processFirst; //module can_process() serves first, alternated
+static can_busOff can_busOffs[2] = {
+    {{busOn}, busOffBackoff, CAN_BUSOFF_FIRST_DELAY, CAN_BUSOFF_MAX_DELAY, 0, 0},
+    {{busOn}, busOffBackoff, CAN_BUSOFF_FIRST_DELAY, CAN_BUSOFF_MAX_DELAY, 0, 0}
+};
+#ifdef CAN_RX_WTIMER
+static uint32 can_timerTicksPerUs=1; //the wide timer counts the system clock
+static uint64 can_timerUsScale=0xFFFFFFFFFFFFFFFFULL; //2^64/can_timerTicksPerUs rounded up
+#endif
+//receive handlers, index 0 means none. Standard ids index a byte per id,
+//exact extended ids are kept sorted for a binary search, masked extended
+//filters are tried in turn when no exact id matches
+static can_rxHandler can_handlers[CAN_HANDLERS+1];
+static uint8 can_stdHandler[2048];
+static can_extHandlerId can_extHandlerIds[CAN_EXT_HANDLER_IDS];
+static uint32 can_extHandlerIdCount;
+static can_extHandlerMask can_extHandlerMasks[CAN_EXT_HANDLER_MASKS];
+static uint32 can_extHandlerMaskCount;
+//software acceptance filter behind the wide hardware masks of can_filterApply():
+//a bit per standard id, an open addressing hash of extended ids
+static uint32 can_stdFilter[2][2048/32];
+static uint32 can_extFilter[2][CAN_FILTER_EXT_SLOTS];
+static uint32 can_filterIdCount[2];
+static uint32 can_filterObjects[2]; //objects configured by can_filterApply()
+static uint32 can_filterRejects[2];
+//work area of can_filterApply()
+static uint32 can_filterIds[CAN_FILTER_IDS];
+static can_idMask can_filterCubes[CAN_FILTER_IDS];
+static const uint32 can_poolMask[3] = {
+    (uint32)CAN_OBJECT_RANGE(CAN_POOL_TX_FIRST, CAN_POOL_TX_OBJECTS),
+    (uint32)CAN_OBJECT_RANGE(CAN_POOL_RX_FIRST, CAN_POOL_RX_OBJECTS),
+    (uint32)CAN_OBJECT_RANGE(CAN_POOL_FIFO_FIRST, CAN_POOL_FIFO_OBJECTS)
+};
+/*******************************************************************************
+ *                      Private Functions                                      *
+ *******************************************************************************/
+/*
+ * Description : index of the lowest set bit, value must not be 0
+ */
+static uint8 can_ctz(uint32 value)
+{
+#if defined(__GNUC__) || defined(__clang__)
+    return __builtin_ctz((unsigned int)value);
+#else
+    uint8 bit=0;
+    while (!(value & 1))
+    {
+        value >>= 1;
+        bit++;
+    }
+    return bit;
+#endif
+}
+/*
+ * Description : index of the highest set bit, value must not be 0
+ */
+static uint8 can_msb(uint32 value)
+{
+#if defined(__GNUC__) || defined(__clang__)
+    return 31-__builtin_clz((unsigned int)value);
+#else
+    uint8 bit=0;
+    while (value >>= 1)
+    {
+        bit++;
+    }
+    return bit;
+#endif
+}
+#ifdef CAN_RX_WTIMER
+/*
+ * Description : microseconds of a wide timer count, the high half of the
+ *               128 bit product with can_timerUsScale built from four 32x32
+ *               multiplies instead of a 64 bit division. Exact up to
+ *               2^64/can_timerTicksPerUs ticks (91 years at 80 MHz); with one
+ *               tick per microsecond the scale cannot be rounded up and the
+ *               result is 1 us low.
+ */
+static uint32 can_timerToUs(uint64 ticks)
+{
+    uint32 tickLow=(uint32)ticks, tickHigh=(uint32)(ticks>>32);
+    uint32 scaleLow=(uint32)can_timerUsScale, scaleHigh=(uint32)(can_timerUsScale>>32);
+    uint64 low=(uint64)tickLow*scaleLow;
+    uint64 cross1=(uint64)tickHigh*scaleLow;
+    uint64 cross2=(uint64)tickLow*scaleHigh;
+    uint64 middle=(low>>32) + (uint32)cross1 + (uint32)cross2;
+
+    return (uint32)((uint64)tickHigh*scaleHigh + (cross1>>32) + (cross2>>32) + (middle>>32));
+}
+/*
+ * Description : starts the wide timer as one 64 bit timer counting the
+ *               system clock up. A timer already running that way (started
+ *               for the other module) keeps its count, one left in another
+ *               mode is configured again.
+ */
+static void can_timerStart(void)
+{
+    uint32 timerBit=SYSCTL_RCGCWTIMER_R0<<CAN_TIMESTAMP_TIMER;
+
+    if (!(SYSCTL_RCGCWTIMER_R & timerBit))
+    {
+        SYSCTL_RCGCWTIMER_R |=timerBit;
+        while (!(SYSCTL_PRWTIMER_R & timerBit));
+    }
+    else if (CAN_WTIMER(CFG) == 0 && (CAN_WTIMER(CTL) & TIMER_CTL_TAEN) &&
+            (CAN_WTIMER(TAMR) & (TIMER_TAMR_TAMR_M | TIMER_TAMR_TACDIR)) == (TIMER_TAMR_TAMR_PERIOD | TIMER_TAMR_TACDIR) &&
+            CAN_WTIMER(TAILR) == 0xFFFFFFFF && CAN_WTIMER(TBILR) == 0xFFFFFFFF)
+    {
+        return;
+    }
+    CAN_WTIMER(CTL) =0;
+    CAN_WTIMER(CFG) =0; //concatenated 64 bit mode
+    CAN_WTIMER(TAMR) =TIMER_TAMR_TAMR_PERIOD | TIMER_TAMR_TACDIR;
+    CAN_WTIMER(TAILR) =0xFFFFFFFF;
+    CAN_WTIMER(TBILR) =0xFFFFFFFF;
+    CAN_WTIMER(CTL) =TIMER_CTL_TAEN;
+}
+/*
+ * Description : ticks of the wide timer per microsecond and the scale of
+ *               can_timerToUs(), 2^64/ticks rounded up, by long division in
+ *               16 bit digits so no 64 bit division is linked
+ */
+static void can_timerSetClock(uint32 clock)
+{
+    uint32 ticks=clock/1000000, remainder=0, part;
+    uint64 scale=0;
+    uint8 digit;
+
+    for (digit=0; digit<4; digit++)
+    {
+        part=remainder<<16 | 0xFFFF;
+        scale=scale<<16 | part/ticks;
+        remainder=part%ticks;
+    }
+    can_timerTicksPerUs=ticks;
+    can_timerUsScale=scale+(ticks > 1); //(2^64-1)/ticks+1, 2^64 does not fit
+}
+#endif
+/*
+ * Description : hands out IF1 and IF2 of a module in turn, so one can be
+ *               filled while the command transfer of the other runs, and
+ *               waits only for the one it returns. The driver programs an
+ *               interface and starts its transfer without being
+ *               interrupted: from the application with interrupts masked,
+ *               or from the ISR of the module.
+ *
+ *  Returns: the interface, 0 if it stayed busy
+ */
+static can_ifRegs* can_nextInterface(can_Module module)
+{
+    can_ifRegs* ifRegs=&CAN_REGS(module)->IF[can_ifTurn[module]];
+
+    can_ifTurn[module] ^=1;
+    return can_waitInterface(ifRegs) ? ifRegs : 0;
+}
+/*
+ * Description : reads a message object and clears its INTPND and NEWDAT
+ *               bits, a set MSGLST bit is cleared and reported. ISR only.
+ *
+ *  Returns: TRUE if the object is a receive object holding new data
+ */
+static bool can_readObject(can_Module module, uint8 messageNum, can_frame* framePtr)
+{
+    can_ifRegs* ifRegs=can_nextInterface(module);
+    uint32 arb1, arb2, mctl;
+
+    if (ifRegs == 0)
+    {
+        return FALSE;
+    }
+    ifRegs->CMSK =CAN_IF1CMSK_ARB | CAN_IF1CMSK_CONTROL | CAN_IF1CMSK_CLRINTPND | CAN_IF1CMSK_NEWDAT |
+            CAN_IF1CMSK_DATAA | CAN_IF1CMSK_DATAB;
+    ifRegs->CRQ =messageNum;
+    CAN_HW_SYNC(ifRegs);
+    if (!can_waitInterface(ifRegs))
+    {
+        return FALSE;
+    }
+    arb1=ifRegs->ARB1;
+    arb2=ifRegs->ARB2;
+    mctl=ifRegs->MCTL;
+    if (mctl & CAN_IF1MCTL_MSGLST) //write the control word back without it
+    {
+        ifRegs->CMSK =CAN_IF1CMSK_WRNRD | CAN_IF1CMSK_CONTROL;
+        ifRegs->MCTL =mctl & ~(CAN_IF1MCTL_NEWDAT | CAN_IF1MCTL_MSGLST | CAN_IF1MCTL_INTPND);
+        ifRegs->CRQ =messageNum;
+        CAN_HW_SYNC(ifRegs);
+    }
+    //only receive objects (DIR=0) with NEWDAT carry a frame
+    if (!(mctl & CAN_IF1MCTL_NEWDAT) || (arb2 & CAN_IF1ARB2_DIR))
+    {
+        return FALSE;
+    }
+    if (arb2 & CAN_IF1ARB2_XTD) //29 bit id
+    {
+        framePtr->flags=CAN_FRAME_EXTENDED;
+        framePtr->ID=((arb2 & 0x1FFF)<<16) | (arb1 & 0xFFFF);
+    }
+    else
+    {
+        framePtr->flags=0;
+        framePtr->ID=(arb2>>2) & 0x7FF;
+    }
+    if (mctl & CAN_IF1MCTL_MSGLST)
+    {
+        framePtr->flags |=CAN_FRAME_LOST;
+    }
+    framePtr->dlc=mctl & CAN_IF1MCTL_DLC_M;
+    framePtr->messageNum=messageNum;
+    framePtr->reserved=0;
+    can_unpackData(ifRegs, framePtr->data);
+    return TRUE;
+}
+/*
+ * Description : clears MSGVAL of a message object so the controller neither
+ *               sends nor receives with it, called with interrupts masked.
+ *               The other interface is tried when the first stays busy.
+ *
+ *  Returns: FALSE if both interfaces stayed busy
+ */
+static bool can_invalidateObject(can_Module module, uint8 messageNum)
+{
+    can_ifRegs* ifRegs=can_nextInterface(module);
+
+    if (ifRegs == 0)
+    {
+        ifRegs=can_nextInterface(module);
+    }
+    if (ifRegs == 0)
+    {
+        return FALSE;
+    }
+    ifRegs->CMSK =CAN_IF1CMSK_WRNRD | CAN_IF1CMSK_ARB | CAN_IF1CMSK_CONTROL;
+    ifRegs->ARB1 =0;
+    ifRegs->ARB2 =0;
+    ifRegs->MCTL =0;
+    ifRegs->CRQ =messageNum;
+    CAN_HW_SYNC(ifRegs);
+    can_txShadows[module][messageNum-1].key=0;
+    return TRUE;
+}
+/*
+ * Description : writes a receive object through an interface taken from
+ *               can_nextInterface(), eob is FALSE for all but the last
+ *               member of a fifo
+ */
+static void can_writeReceive(can_ifRegs* ifRegs, const can_receiveStruct* receivePtr,
+                             uint8 messageNum, bool eob)
+{
+    ifRegs->CMSK =CAN_IF1CMSK_WRNRD | CAN_IF1CMSK_MASK | CAN_IF1CMSK_ARB | CAN_IF1CMSK_CONTROL |
+            CAN_IF1CMSK_DATAA | CAN_IF1CMSK_DATAB;
+    if(receivePtr->ID_type == normal) // 11 bit id in bits 2:12
+    {
+        ifRegs->MSK1 =0;
+        ifRegs->MSK2 =CAN_IF1MSK2_MXTD | ((receivePtr->ID_mask & 0x7FF)<<2); //extended frames never match
+        ifRegs->ARB1 =0;
+        ifRegs->ARB2 =CAN_IF1ARB2_MSGVAL | ((receivePtr->ID & 0x7FF)<<2); //direction receive
+    }
+    else //29 bit id
+    {
+        ifRegs->MSK1 =receivePtr->ID_mask & 0xFFFF;
+        ifRegs->MSK2 =CAN_IF1MSK2_MXTD | ((receivePtr->ID_mask>>16) & 0x1FFF);
+        ifRegs->ARB1 =receivePtr->ID & 0xFFFF;
+        ifRegs->ARB2 =CAN_IF1ARB2_MSGVAL | CAN_IF1ARB2_XTD | ((receivePtr->ID>>16) & 0x1FFF);
+    }
+    ifRegs->MCTL =CAN_IF1MCTL_UMASK | CAN_IF1MCTL_RXIE | (eob ? CAN_IF1MCTL_EOB : 0) |
+            (receivePtr->bytesNum & CAN_IF1MCTL_DLC_M);
+    ifRegs->CRQ =messageNum;
+    CAN_HW_SYNC(ifRegs);
+    can_txShadows[receivePtr->module][(messageNum-1) & 31].key=0;
+}
+/*
+ * Description : allocates count consecutive objects of a pool, the highest
+ *               free run first
+ *
+ *  Returns: lowest object of the run, CAN_NO_OBJECT if there is none or pool
+ *           is not a can_objectPool
+ */
+static can_objectHandle can_allocRun(can_Module module, can_objectPool pool, uint8 count)
+{
+    can_objectHandle first=CAN_NO_OBJECT;
+    uint32 state, available, run=(uint32)CAN_OBJECT_RANGE(1, count);
+    sint32 shift;
+
+    if ((uint32)pool > poolFifo)
+    {
+        return CAN_NO_OBJECT;
+    }
+    state=CAN_ENTER_CRITICAL();
+    available=can_poolMask[pool] & ~can_objectsInUse[module];
+    for (shift=32-count; shift>=0; shift--)
+    {
+        if ((available & (run<<shift)) == (run<<shift))
+        {
+            can_objectsInUse[module] |=run<<shift;
+            first=shift+1;
+            break;
+        }
+    }
+    CAN_EXIT_CRITICAL(state);
+    return first;
+}
+/*
+ * Description : objects of the fifo holding an object: the members above the
+ *               end of the previous fifo up to the first end at or above it,
+ *               0 if no end follows (the object is not in a fifo)
+ */
+static uint32 can_fifoMembers(can_Module module, uint8 messageNum)
+{
+    uint32 below=(uint32)CAN_OBJECT_RANGE(1, messageNum-1);
+    uint32 endsAbove=can_fifoEnds[module] & ~below;
+    uint32 endsBelow=can_fifoEnds[module] & below;
+    uint32 members;
+
+    if (endsAbove == 0)
+    {
+        return 0;
+    }
+    members=(uint32)CAN_OBJECT_RANGE(1, can_ctz(endsAbove)+1);
+    if (endsBelow)
+    {
+        members &=~(uint32)CAN_OBJECT_RANGE(1, can_msb(endsBelow)+1);
+    }
+    return members & can_fifoObjects[module];
+}
+/*
+ * Description : pushes a frame into the ring of a module, counts an overflow
+ *               if it is full
+ */
+static void can_rxPush(can_rxRing* ring, const can_frame* framePtr)
+{
+    if (ring->head - ring->tail >= CAN_RX_RING_SIZE)
+    {
+        ring->overflows++;
+        return;
+    }
+    ring->frame[ring->head & (CAN_RX_RING_SIZE-1)]=*framePtr;
+    CAN_BARRIER();
+    ring->head++;
+}
+static uint32 can_extFilterSlot(uint32 ID)
+{
+    return (uint32)((ID*0x9E3779B1UL)>>16) & (CAN_FILTER_EXT_SLOTS-1);
+}
+/*
+ * Description : software stage of the acceptance filter
+ *
+ *  Returns: TRUE if the id of the frame was added with can_filterAdd()
+ */
+static bool can_filterMatch(can_Module module, const can_frame* framePtr)
+{
+    uint32 slot, entry;
+
+    if (!(framePtr->flags & CAN_FRAME_EXTENDED))
+    {
+        return (can_stdFilter[module][(framePtr->ID>>5) & 63]>>(framePtr->ID & 31)) & 1;
+    }
+    for (slot=can_extFilterSlot(framePtr->ID); (entry=can_extFilter[module][slot]) != 0;
+            slot=(slot+1) & (CAN_FILTER_EXT_SLOTS-1))
+    {
+        if (entry == (framePtr->ID | CAN_FILTER_USED))
+        {
+            return TRUE;
+        }
+    }
+    return FALSE;
+}
+/*
+ * Description : stamps a frame read by the ISR (with the stamp taken at ISR
+ *               entry or now) and puts it in the module ring, frames of a
+ *               can_filterApply() object whose id was not added to the
+ *               filter are counted as rejects and dropped
+ */
+static void can_rxDeliver(can_Module module, can_frame* framePtr, uint64 entryStamp)
+{
+    if ((can_filterObjects[module] & 1UL<<(framePtr->messageNum-1)) && !can_filterMatch(module, framePtr))
+    {
+        can_filterRejects[module]++;
+        return;
+    }
+    can_moduleStats[module].rxFrames++;
+    framePtr->timestamp=CAN_RX_TIMESTAMP_AT_ENTRY ? entryStamp : CAN_RX_TIMESTAMP()-CAN_RX_LATENCY;
+    can_rxPush(&can_rxRings[module], framePtr);
+}
+/*
+ * Description : arbitration priority of a frame, standard ids win over
+ *               extended ids with the same 11 bit base
+ */
+static uint32 can_priorityKey(const can_frame* framePtr)
+{
+    if (!(framePtr->flags & CAN_FRAME_EXTENDED))
+    {
+        return (framePtr->ID & 0x7FF)<<21;
+    }
+    return ((framePtr->ID>>18) & 0x7FF)<<21 | 0x00100000 | (framePtr->ID & 0x3FFFF)<<1;
+}
+static bool can_txBefore(const can_txEntry* a, const can_txEntry* b)
+{
+    return a->key < b->key || (a->key == b->key && (sint32)(a->sequence - b->sequence) < 0);
+}
+static void can_txPush(can_txQueue* queue, const can_frame* framePtr)
+{
+    uint32 child=queue->count++;
+    can_txEntry entry;
+
+    entry.frame=*framePtr;
+    entry.frame.timestamp=CAN_RX_TIMESTAMP();
+    entry.key=can_priorityKey(framePtr);
+    entry.sequence=queue->sequence++;
+    while (child > 0 && can_txBefore(&entry, &queue->heap[(child-1)/2]))
+    {
+        queue->heap[child]=queue->heap[(child-1)/2];
+        child=(child-1)/2;
+    }
+    queue->heap[child]=entry;
+}
+static void can_txPop(can_txQueue* queue)
+{
+    can_txEntry last=queue->heap[--queue->count];
+    uint32 parent=0, child;
+
+    while ((child=2*parent+1) < queue->count)
+    {
+        if (child+1 < queue->count && can_txBefore(&queue->heap[child+1], &queue->heap[child]))
+        {
+            child++;
+        }
+        if (!can_txBefore(&queue->heap[child], &last))
+        {
+            break;
+        }
+        queue->heap[parent]=queue->heap[child];
+        parent=child;
+    }
+    queue->heap[parent]=last;
+}
+/*
+ * Description : free transmit objects a frame of priority key may be loaded
+ *               into. The controller sends the lowest pending object first,
+ *               so the frame goes above every busy object holding a frame of
+ *               the same or a higher priority and below every one holding a
+ *               lower priority.
+ */
+static uint32 can_txLoadable(const can_txQueue* queue, uint32 key)
+{
+    uint32 busy=queue->busyObjects, allowed=CAN_TX_OBJECT_MASK & ~queue->busyObjects;
+    uint8 messageNum;
+
+    while (busy)
+    {
+        messageNum=can_ctz(busy)+1;
+        busy &=busy-1;
+        if (can_priorityKey(&queue->inFlight[messageNum-CAN_TX_FIRST_OBJECT]) <= key)
+        {
+            allowed &=~(uint32)CAN_OBJECT_RANGE(1, messageNum);
+        }
+        else
+        {
+            allowed &=(uint32)CAN_OBJECT_RANGE(1, messageNum-1);
+        }
+    }
+    return allowed;
+}
+/*
+ * Description : moves queued frames into free transmit objects, called with
+ *               the module interrupt masked
+ */
+static void can_txFeed(can_Module module)
+{
+    can_txQueue* queue=&can_txQueues[module];
+    can_ifRegs* ifRegs;
+    const can_frame* framePtr;
+    uint32 freeObjects, direction;
+    uint8 messageNum;
+
+    while (queue->count > 0 && (freeObjects=can_txLoadable(queue, queue->heap[0].key)) != 0)
+    {
+        ifRegs=can_nextInterface(module);
+        if (ifRegs == 0)
+        {
+            return; //retried on the next interrupt or enqueue
+        }
+        messageNum=can_ctz(freeObjects)+1;
+        framePtr=&queue->heap[0].frame;
+        ifRegs->CMSK =CAN_IF1CMSK_WRNRD | CAN_IF1CMSK_ARB | CAN_IF1CMSK_CONTROL | CAN_IF1CMSK_TXRQST |
+                CAN_IF1CMSK_DATAA | CAN_IF1CMSK_DATAB;
+        //TXRQST on a receive object (DIR=0) sends a remote frame, the
+        //answer is stored in the same object and also ends the request
+        direction=(framePtr->flags & CAN_FRAME_REMOTE) ? 0 : CAN_IF1ARB2_DIR;
+        if (!(framePtr->flags & CAN_FRAME_EXTENDED))
+        {
+            ifRegs->ARB1 =0;
+            ifRegs->ARB2 =CAN_IF1ARB2_MSGVAL | direction | ((framePtr->ID & 0x7FF)<<2);
+        }
+        else
+        {
+            ifRegs->ARB1 =framePtr->ID & 0xFFFF;
+            ifRegs->ARB2 =CAN_IF1ARB2_MSGVAL | CAN_IF1ARB2_XTD | direction | ((framePtr->ID>>16) & 0x1FFF);
+        }
+        ifRegs->MCTL =CAN_IF1MCTL_TXIE | CAN_IF1MCTL_EOB | (direction ? 0 : CAN_IF1MCTL_RXIE) |
+                (framePtr->dlc & CAN_IF1MCTL_DLC_M);
+        can_packData(ifRegs, framePtr->data);
+        ifRegs->CRQ =messageNum;
+        CAN_HW_SYNC(ifRegs);
+        queue->inFlight[messageNum-CAN_TX_FIRST_OBJECT]=*framePtr;
+        queue->inFlight[messageNum-CAN_TX_FIRST_OBJECT].messageNum=messageNum;
+        queue->requestedAt[messageNum-CAN_TX_FIRST_OBJECT]=CAN_RX_TIMESTAMP();
+        queue->busyObjects |=1UL<<(messageNum-1);
+        can_txPop(queue);
+    }
+}
+/*
+ * Description : latency entry of an id of the transmit queue, 0 when the id
+ *               is not tracked
+ */
+static can_txLatency* can_txLatencyOf(can_txQueue* queue, uint32 ID, uint8 flags)
+{
+    uint32 i;
+
+    for (i=0; i<queue->latencyIds; i++)
+    {
+        if (queue->latency[i].ID == ID && queue->latency[i].flags == (flags & CAN_FRAME_EXTENDED))
+        {
+            return &queue->latency[i];
+        }
+    }
+    return 0;
+}
+/*
+ * Description : log2 histogram bucket of a delay, the last one is open
+ */
+static uint8 can_latencyBucket(uint64 ticks)
+{
+    uint8 bucket;
+
+    if (ticks == 0)
+    {
+        return 0;
+    }
+    bucket=(ticks > 0xFFFFFFFF) ? 32 : can_msb((uint32)ticks);
+    return (bucket < CAN_TX_LATENCY_BUCKETS) ? bucket : CAN_TX_LATENCY_BUCKETS-1;
+}
+/*
+ * Description : adds the queueing and bus delay of a sent frame to the
+ *               histograms of its id
+ */
+static void can_txMeasure(can_txQueue* queue, const can_frame* framePtr, uint64 requestedAt, uint64 completedAt)
+{
+    can_txLatency* latency=can_txLatencyOf(queue, framePtr->ID, framePtr->flags);
+    uint64 queueTicks=requestedAt-framePtr->timestamp, busTicks=completedAt-requestedAt;
+
+    if (latency == 0)
+    {
+        return;
+    }
+    latency->frames++;
+    latency->queueHistogram[can_latencyBucket(queueTicks)]++;
+    latency->busHistogram[can_latencyBucket(busTicks)]++;
+    queueTicks=(queueTicks < 0xFFFFFFFF) ? queueTicks : 0xFFFFFFFF;
+    busTicks=(busTicks < 0xFFFFFFFF) ? busTicks : 0xFFFFFFFF;
+    if (queueTicks > latency->maxQueue)
+    {
+        latency->maxQueue=(uint32)queueTicks;
+    }
+    if (busTicks > latency->maxBus)
+    {
+        latency->maxBus=(uint32)busTicks;
+    }
+}
+/*
+ * Description : keeps a sent frame for the transmit callback
+ */
+static void can_eventSent(can_eventRing* events, const can_frame* framePtr)
+{
+    if (events->sentHead - events->sentTail >= CAN_EVENT_RING_SIZE)
+    {
+        events->overflows++;
+        return;
+    }
+    events->sent[events->sentHead & (CAN_EVENT_RING_SIZE-1)]=*framePtr;
+    CAN_BARRIER();
+    events->sentHead++;
+}
+/*
+ * Description : keeps a CANSTS value for the status callback
+ */
+static void can_eventStatus(can_eventRing* events, uint32 status)
+{
+    if (events->statusHead - events->statusTail >= CAN_EVENT_RING_SIZE)
+    {
+        events->overflows++;
+        return;
+    }
+    events->status[events->statusHead & (CAN_EVENT_RING_SIZE-1)]=status;
+    CAN_BARRIER();
+    events->statusHead++;
+}
+/*
+ * Description : invalidates a sent transmit object (which also clears its
+ *               interrupt pending) so it neither answers nor receives frames
+ *               while free, measures its latency and keeps the frame stamped
+ *               with the completion time for the transmit callback. The answer
+ *               to a remote frame that reached the object first is put in
+ *               the receive ring, stamped like the received frames.
+ */
+static void can_txComplete(can_Module module, uint8 messageNum, uint64 entryStamp)
+{
+    can_txQueue* queue=&can_txQueues[module];
+    can_frame* framePtr=&queue->inFlight[messageNum-CAN_TX_FIRST_OBJECT];
+    uint64 completedAt=CAN_RX_TIMESTAMP()-CAN_RX_LATENCY;
+    can_frame answer;
+
+    if ((framePtr->flags & CAN_FRAME_REMOTE) && can_readObject(module, messageNum, &answer))
+    {
+        can_rxDeliver(module, &answer, entryStamp);
+    }
+    can_invalidateObject(module, messageNum);
+    queue->busyObjects &=~(1UL<<(messageNum-1));
+    can_moduleStats[module].txFrames++;
+    can_txMeasure(queue, framePtr, queue->requestedAt[messageNum-CAN_TX_FIRST_OBJECT], completedAt);
+    framePtr->timestamp=completedAt;
+    if (queue->callback != 0)
+    {
+        can_eventSent(&can_events[module], framePtr);
+    }
+}
+/*
+ * Description : sets TXRQST again on the busy transmit objects that lost it
+ *               while the module was off the bus; an object with its
+ *               interrupt pending was sent and is left to can_txComplete()
+ */
+static void can_txResume(can_Module module, can_Regs* regs)
+{
+    can_ifRegs* ifRegs;
+    uint32 lost;
+    uint8 messageNum;
+
+    lost=can_txQueues[module].busyObjects & ~((regs->TXRQ[0] & 0xFFFF) | (regs->TXRQ[1] & 0xFFFF)<<16) &
+            ~((regs->MSGINT[0] & 0xFFFF) | (regs->MSGINT[1] & 0xFFFF)<<16);
+    while (lost)
+    {
+        ifRegs=can_nextInterface(module);
+        if (ifRegs == 0)
+        {
+            return;
+        }
+        messageNum=can_ctz(lost)+1;
+        ifRegs->CMSK =CAN_IF1CMSK_WRNRD | CAN_IF1CMSK_TXRQST;
+        ifRegs->CRQ =messageNum;
+        CAN_HW_SYNC(ifRegs);
+        lost &=lost-1;
+    }
+}
+/*
+ * Description : TRUE when a module waits in bus-off for a back-off delay
+ *               that is over
+ */
+static bool can_busOffDue(const can_busOff* busOff)
+{
+    //difference taken modulo 2^32, uint32 is wider on 64 bit hosts
+    return busOff->info.state == busOffWaiting && busOff->mode == busOffBackoff &&
+            ((CAN_TIME_US()-busOff->dueAt) & 0xFFFFFFFF) < 0x80000000;
+}
+#if defined(CAN_RX_WTIMER) && !defined(CAN_HOST_SIM)
+/*
+ * Description : sets the wide timer match interrupt to the end of the earliest
+ *               back-off, or turns it off when no module waits for one, so
+ *               bus-off is left even if can_process() does not run
+ */
+static void can_busOffWake(void)
+{
+    uint64 now=can_wideTimer(), wake=0;
+    uint32 left, state;
+    uint8 module;
+
+    state=CAN_ENTER_CRITICAL();
+    for (module=0; module<2; module++)
+    {
+        if (can_busOffs[module].info.state == busOffWaiting && can_busOffs[module].mode == busOffBackoff)
+        {
+            left=(can_busOffs[module].dueAt-can_timerToUs(now)) & 0xFFFFFFFF;
+            left=(left < 0x80000000) ? left : 0;
+            if (wake == 0 || now+(uint64)left*can_timerTicksPerUs < wake)
+            {
+                wake=now+(uint64)left*can_timerTicksPerUs;
+            }
+        }
+    }
+    if (wake == 0)
+    {
+        CAN_WTIMER(IMR) &=~TIMER_IMR_TAMIM;
+        CAN_EXIT_CRITICAL(state);
+        return;
+    }
+    CAN_WTIMER(TAMATCHR) =(uint32)wake;
+    CAN_WTIMER(TBMATCHR) =(uint32)(wake>>32);
+    CAN_WTIMER(TAMR) |=TIMER_TAMR_TAMIE;
+    CAN_WTIMER(ICR) =TIMER_ICR_TAMCINT;
+    CAN_WTIMER(IMR) |=TIMER_IMR_TAMIM;
+    (&NVIC_EN0_R)[(CAN_WTIMER_INT-16)>>5] =1UL<<((CAN_WTIMER_INT-16) & 31); //interrupt 94 for WTIMER0
+    if (can_wideTimer() >= wake)
+    {   //the count went past the match while it was written
+        NVIC_SW_TRIG_R =CAN_WTIMER_INT-16;
+    }
+    CAN_EXIT_CRITICAL(state);
+}
+#else
+//can_process() polls the back-off
+#define can_busOffWake()
+#endif
+/*
+ * Description : the module went bus-off and set INIT: the error counters are
+ *               logged and INIT is cleared now (immediate, or back-off without
+ *               a clock), once the back-off wait is over (wide timer match
+ *               interrupt or can_process()) or by can_busOffRecover()
+ */
+static void can_busOffEnter(can_Module module, can_Regs* regs)
+{
+    can_busOff* busOff=&can_busOffs[module];
+    uint32 error=regs->ERR, delay, shift;
+
+    busOff->info.count++;
+    busOff->info.consecutive++;
+    busOff->info.lastTec=(uint8)((error & CAN_ERR_TEC_M)>>CAN_ERR_TEC_S);
+    busOff->info.lastRec=(uint8)((error & CAN_ERR_REC_M)>>CAN_ERR_REC_S);
+    busOff->offAt=CAN_TIME_US();
+    if (busOff->mode == busOffImmediate || (busOff->mode == busOffBackoff && !CAN_BUSOFF_TIMED))
+    {
+        regs->CTL &=~CAN_CTL_INIT;
+        busOff->info.state=busOffRecovering;
+        return;
+    }
+    busOff->info.state=busOffWaiting;
+    if (busOff->mode == busOffBackoff)
+    {
+        //doubled for each bus-off in a row, the frames keep failing
+        delay=busOff->firstDelay;
+        for (shift=1; shift<busOff->info.consecutive && delay<busOff->maxDelay; shift++)
+        {
+            delay <<=1;
+        }
+        if (delay > busOff->maxDelay)
+        {
+            delay=busOff->maxDelay;
+        }
+        busOff->dueAt=busOff->offAt+delay;
+        can_busOffWake();
+        CAN_DEFER_SIGNAL();
+    }
+}
+/*
+ * Description : BOFF cleared after the 129x11 recessive bits, the recovery
+ *               time is recorded and the transmit objects are requested again
+ */
+static void can_busOffLeave(can_Module module, can_Regs* regs)
+{
+    can_busOff* busOff=&can_busOffs[module];
+    uint32 recovery=(CAN_TIME_US()-busOff->offAt) & 0xFFFFFFFF;
+
+    busOff->info.state=busOn;
+    busOff->info.lastRecoveryUs=recovery;
+    if (recovery > busOff->info.maxRecoveryUs)
+    {
+        busOff->info.maxRecoveryUs=recovery;
+    }
+    can_txResume(module, regs);
+}
+/*
+ * Description : bus health counters of a status interrupt, the state
+ *               transitions are found against the CANSTS value of the
+ *               previous one
+ */
+static void can_countStatus(can_Module module, can_Regs* regs, uint32 status)
+{
+    can_stats* stats=&can_moduleStats[module];
+    uint32 rising=status & ~can_status[module], error=regs->ERR;
+    uint8 lec=(uint8)(status & CAN_STS_LEC_M);
+
+    stats->txOk +=(status & CAN_STS_TXOK) ? 1 : 0;
+    stats->rxOk +=(status & CAN_STS_RXOK) ? 1 : 0;
+    if (lec != CAN_STS_LEC_NONE && lec != CAN_STS_LEC_NOEVENT)
+    {
+        stats->lec[lec]++;
+    }
+    stats->errorWarning +=(rising & CAN_STS_EWARN) ? 1 : 0;
+    stats->errorPassive +=(rising & CAN_STS_EPASS) ? 1 : 0;
+    stats->busOff +=(rising & CAN_STS_BOFF) ? 1 : 0;
+    if (((error & CAN_ERR_TEC_M)>>CAN_ERR_TEC_S) > stats->peakTec)
+    {
+        stats->peakTec=(uint8)((error & CAN_ERR_TEC_M)>>CAN_ERR_TEC_S);
+    }
+    if (((error & CAN_ERR_REC_M)>>CAN_ERR_REC_S) > stats->peakRec)
+    {
+        stats->peakRec=(uint8)((error & CAN_ERR_REC_M)>>CAN_ERR_REC_S);
+    }
+}
+/*
+ * Description : status interrupt: reading CANSTS clears it, TXOK/RXOK are
+ *               cleared and LEC is set to "no event" by writing back so the
+ *               next event is seen, BOFF/EWARN/EPASS are kept for
+ *               can_getStatus(), a change of BOFF moves the bus-off state
+ *               machine and the value is kept for the status callback
+ */
+static void can_serviceStatus(can_Module module, can_Regs* regs)
+{
+    uint32 status=regs->STS;
+    can_busState busState=can_busOffs[module].info.state;
+
+    CAN_HW_STATUS_READ(regs);
+    regs->STS =CAN_STS_LEC_NOEVENT;
+    can_countStatus(module, regs, status);
+    can_status[module]=status;
+    if (status & CAN_STS_TXOK)
+    {
+        can_busOffs[module].info.consecutive=0;
+    }
+    if ((status & CAN_STS_BOFF) && busState == busOn)
+    {
+        can_busOffEnter(module, regs);
+    }
+    else if (!(status & CAN_STS_BOFF) && busState == busOffRecovering)
+    {
+        can_busOffLeave(module, regs);
+    }
+    if (can_statusCallbacks[module] != 0)
+    {
+        can_eventStatus(&can_events[module], status);
+    }
+}
+/*
+ * Description : interrupt service shared by both modules, the top half: it
+ *               only moves frames from the message RAM into the ring,
+ *               acknowledges the objects and feeds the transmit queue; the
+ *               handlers and callbacks run in can_process(), woken by
+ *               CAN_DEFER_SIGNAL().
+ *               CANINT gives the status interrupt first, then the message
+ *               interrupts are served from the MSG1INT/MSG2INT bitmaps lowest
+ *               object first (TX complete, whole fifo, single receive
+ *               object). At most CAN_ISR_OBJECT_BUDGET objects are read per
+ *               invocation, the interrupt stays pending for the others.
+ */
+static void can_serviceInterrupt(can_Module module)
+{
+    can_Regs* regs=CAN_REGS(module);
+    can_isrLoad* load=&can_isrLoads[module];
+    uint64 entryStamp=CAN_RX_TIMESTAMP_AT_ENTRY ? CAN_RX_TIMESTAMP()-CAN_RX_LATENCY : 0;
+    uint32 start=CAN_ISR_CLOCK(), head=can_rxRings[module].head, ticks;
+    uint32 events=can_events[module].sentHead + can_events[module].statusHead;
+    can_frame frame;
+    uint32 pending, members, intId, budget=CAN_ISR_OBJECT_BUDGET;
+    uint8 messageNum;
+
+    while (budget > 0 && (intId=regs->INT & CAN_INT_INTID_M) != CAN_INT_INTID_NONE)
+    {
+        if (intId == CAN_INT_INTID_STATUS)
+        {
+            can_serviceStatus(module, regs);
+            budget--;
+            continue;
+        }
+        pending=(regs->MSGINT[0] & 0xFFFF) | (regs->MSGINT[1] & 0xFFFF)<<16;
+        if (pending == 0)
+        {
+            break;
+        }
+        while (pending && budget > 0)
+        {
+            messageNum=can_ctz(pending)+1;
+            pending &=pending-1;
+            if (can_txQueues[module].busyObjects & 1UL<<(messageNum-1))
+            {
+                can_txComplete(module, messageNum, entryStamp);
+                budget--;
+                continue;
+            }
+            members=(can_fifoObjects[module] & 1UL<<(messageNum-1)) ? can_fifoMembers(module, messageNum) : 0;
+            if (members != 0)
+            {
+                //rest of the fifo from this member, oldest frames first
+                members &=~(uint32)CAN_OBJECT_RANGE(1, messageNum-1);
+                pending &=~members;
+                while (members && budget > 0)
+                {
+                    if (can_readObject(module, can_ctz(members)+1, &frame))
+                    {
+                        can_rxDeliver(module, &frame, entryStamp);
+                    }
+                    members &=members-1;
+                    budget--;
+                }
+                continue;
+            }
+            if (can_readObject(module, messageNum, &frame))
+            {
+                can_rxDeliver(module, &frame, entryStamp);
+            }
+            budget--;
+        }
+    }
+    can_txFeed(module);
+    if (can_rxRings[module].head != head ||
+            can_events[module].sentHead + can_events[module].statusHead != events)
+    {
+        CAN_DEFER_SIGNAL();
+    }
+    ticks=(CAN_ISR_CLOCK() - start) & CAN_ISR_CLOCK_MASK;
+    load->invocations++;
+    if (CAN_ISR_OBJECT_BUDGET-budget > load->maxObjects)
+    {
+        load->maxObjects=CAN_ISR_OBJECT_BUDGET-budget;
+    }
+    if (ticks > load->maxTicks)
+    {
+        load->maxTicks=ticks;
+    }
+    if (budget == 0 && (regs->INT & CAN_INT_INTID_M) != CAN_INT_INTID_NONE)
+    {
+        load->budgetExhausted++;
+    }
+}
+/*
+ * Description : empties the slots of can_handlers that no standard id,
+ *               extended id or extended filter refers to any more
+ *
+ *  Returns: TRUE if a slot was freed
+ */
+static bool can_releaseHandlerSlots(void)
+{
+    bool used[CAN_HANDLERS+1]={FALSE};
+    bool freed=FALSE;
+    uint32 i;
+
+    for (i=0; i<2048; i++)
+    {
+        used[can_stdHandler[i]]=TRUE;
+    }
+    for (i=0; i<can_extHandlerIdCount; i++)
+    {
+        used[can_extHandlerIds[i].handler]=TRUE;
+    }
+    for (i=0; i<can_extHandlerMaskCount; i++)
+    {
+        used[can_extHandlerMasks[i].handler]=TRUE;
+    }
+    for (i=1; i<=CAN_HANDLERS; i++)
+    {
+        if (!used[i] && can_handlers[i] != 0)
+        {
+            can_handlers[i]=0;
+            freed=TRUE;
+        }
+    }
+    return freed;
+}
+/*
+ * Description : slot of a handler in can_handlers, a new slot is taken for a
+ *               function not seen before. When every slot is taken the slots
+ *               of handlers no longer registered for any id are freed first.
+ *
+ *  Returns: 1..CAN_HANDLERS, 0 if every slot is in use
+ */
+static uint8 can_handlerSlot(can_rxHandler handler)
+{
+    uint8 slot, freeSlot=0;
+
+    do
+    {
+        for (slot=1; slot<=CAN_HANDLERS; slot++)
+        {
+            if (can_handlers[slot] == handler)
+            {
+                return slot;
+            }
+            if (can_handlers[slot] == 0 && freeSlot == 0)
+            {
+                freeSlot=slot;
+            }
+        }
+    } while (freeSlot == 0 && can_releaseHandlerSlots());
+    if (freeSlot != 0)
+    {
+        can_handlers[freeSlot]=handler;
+    }
+    return freeSlot;
+}
+/*
+ * Description : position of an extended id in can_extHandlerIds, or where
+ *               it is to be inserted
+ */
+static uint32 can_extHandlerSearch(uint32 ID)
+{
+    uint32 low=0, high=can_extHandlerIdCount, middle;
+
+    while (low < high)
+    {
+        middle=(low+high)/2;
+        if (can_extHandlerIds[middle].ID < ID)
+        {
+            low=middle+1;
+        }
+        else
+        {
+            high=middle;
+        }
+    }
+    return low;
+}
+/*
+ * Description : handler registered for the id of a frame
+ *
+ *  Returns: 0 if there is none
+ */
+static can_rxHandler can_findHandler(const can_frame* framePtr)
+{
+    uint32 i;
+
+    if (!(framePtr->flags & CAN_FRAME_EXTENDED))
+    {
+        return can_handlers[can_stdHandler[framePtr->ID & 0x7FF]];
+    }
+    i=can_extHandlerSearch(framePtr->ID);
+    if (i < can_extHandlerIdCount && can_extHandlerIds[i].ID == framePtr->ID)
+    {
+        return can_handlers[can_extHandlerIds[i].handler];
+    }
+    for (i=0; i<can_extHandlerMaskCount; i++)
+    {
+        if (((framePtr->ID ^ can_extHandlerMasks[i].ID) & can_extHandlerMasks[i].mask) == 0)
+        {
+            return can_handlers[can_extHandlerMasks[i].handler];
+        }
+    }
+    return 0;
+}
 /*******************************************************************************
  *                      Functions Definitions                                  *
  *******************************************************************************/
@@ -13,800 +1182,1397 @@
  *  1. configure the GPIO resgisters
  *     enable the clk to the port, set the alternative function, set the peripheral
  *     disable analog function and enable digital function.
- *  2.  Set the CANBIT register which contains of:
- *      1. baud rate prescalar
- *      2. tTSeg1 = tProp + tPhase1-1
- *      3. tTSeg2 = tPhase2-1
- *      4. sjw= sjw-1
- *  3. enable interrupts
+ *  2.  Set the CANBIT and CANBRPE registers, from the precomputed table for
+ *      clock and rate, or with clockCustom (CAN_BIT_TIMING_SOLVER=1) from the
+ *      best setting of can_computeBitTiming() for bitRate, Fsys (1 MHz at
+ *      least, the time stamps count microseconds of it) and delays, n time
+ *      quanta per bit (0 lets the solver choose)
+ *  3. enable interrupts: message objects (IE), TXOK/RXOK/bus error (SIE) and
+ *     bus-off/error warning changes (EIE)
+ *
+ *  Arguments: pointer to structure holding the required info
+ *  Returns: returns false if no bit timing fits the configuration
+ *           returns true if else
+ */
+bool can_init(const can_configStruct* configPtr)
+{
+    CAN_PROFILE_FUNCTION(can_init);
+    uint32 bitValue, brpeValue, clock;
+
+    if (configPtr->clock != clockCustom)
+    {
+        if (configPtr->clock > clock80MHz || configPtr->rate > bitRate1M)
+        {
+            return FALSE;
+        }
+        bitValue=can_bitTable[configPtr->clock-1][configPtr->rate].BIT;
+        brpeValue=can_bitTable[configPtr->clock-1][configPtr->rate].BRPE;
+        clock=can_tableClock[configPtr->clock-1];
+    }
+    else
+    {
+#if CAN_BIT_TIMING_SOLVER
+        can_bitTimingRequest request;
+        can_bitTimingResult result;
+
+        if (configPtr->Fsys < 1000000 || configPtr->Fsys > 0xFFFFFFFF)
+        {
+            return FALSE;
+        }
+        request.Fsys=(uint32)configPtr->Fsys;
+        request.bitRate=(uint32)configPtr->bitRate;
+        request.propDelay=(uint32)(configPtr->delays*1000000000.0f + 0.5f); //seconds to ns
+        request.samplePoint=0;
+        request.quanta=configPtr->n;
+        if (!can_computeBitTiming(&request, &result))
+        {
+            return FALSE;
+        }
+        bitValue=result.timing[0].BIT;
+        brpeValue=result.timing[0].BRPE;
+        clock=(uint32)configPtr->Fsys;
+#else
+        return FALSE;
+#endif
+    }
+
+    if (configPtr->module==0)
+    {   //initialize clk for can0
+        SYSCTL_RCGC0_R |= SYSCTL_RCGC0_CAN0;
+
+        //GPIO Configuration
+        //for CAN0 we will use port B
+        //first we need to enable the clk for the port
+        SYSCTL_RCGC2_R |=SYSCTL_RCGC2_GPIOB;
+        //set the alternate function
+        GPIO_PORTB_AFSEL_R |=0x30;
+        //set the function to can0
+        GPIO_PORTB_PCTL_R &=~0X00FF0000;
+        GPIO_PORTB_PCTL_R |=0X00880000;
+        //disable the analog function and enable the digital function
+        GPIO_PORTB_AMSEL_R &= ~0x30;
+        GPIO_PORTB_DEN_R |= 0x30;
+    }
+    else
+    {
+        //initialize clk for can1
+        SYSCTL_RCGC0_R |= SYSCTL_RCGC0_CAN1;
+        //GPIO configuration
+        //first we need to enable the clk for the port
+        SYSCTL_RCGC2_R |=SYSCTL_RCGC2_GPIOA;
+        //set the alternate function
+        GPIO_PORTA_AFSEL_R |=0x03;
+        //set the function to can1
+        GPIO_PORTA_PCTL_R &=~0X000000FF;
+        GPIO_PORTA_PCTL_R |=0X00000088;
+        //diable the analog function and enable the digital function
+        GPIO_PORTA_AMSEL_R &= ~0x03;
+        GPIO_PORTA_DEN_R |= 0x03;
+    }
+#ifdef CAN_RX_WTIMER
+    can_timerStart(); //receive time stamps
+#endif
+#ifndef CAN_HOST_SIM
+    //ISR durations: DEMCR.TRCENA powers the DWT, CYCCNTENA starts its counter
+    NVIC_DBG_INT_R |=0x01000000;
+    CAN_DWT_CTRL_R |=0x00000001;
+#endif
+#ifdef CAN_RX_WTIMER
+    can_timerSetClock(clock);
+#endif
+    can_moduleClock[configPtr->module]=clock;
+    if (!can_setBitTiming(configPtr->module, bitValue, brpeValue))
+    {
+        return FALSE;
+    }
+    can_busOffs[configPtr->module].info.state=busOn; //INIT was cleared
+    can_busOffs[configPtr->module].info.consecutive=0;
+    //ENABLE INTERRUPTS
+    CAN_REGS(configPtr->module)->CTL |=CAN_CTL_IE | CAN_CTL_SIE | CAN_CTL_EIE;
+    NVIC_EN1_R =0x00000080<<configPtr->module; //CAN0 is interrupt 39, CAN1 is 40
+
+    return TRUE;
+
+
+}
+/*
+ * Description : Function to program the bit timing of a module, also used to
+ *  re-initialize it (bus-off recovery): INIT and CCE are set, CANBRPE and the
+ *  whole CANBIT word are written once each and read back, then CANCTL is
+ *  restored with INIT and CCE cleared. The other CANCTL bits are kept.
+ *
+ *  Arguments: module, CANBIT value, CANBRPE value (can_bitTiming.BIT/BRPE)
+ *  Returns: FALSE if the registers do not read back the written values
+ */
+bool can_setBitTiming(can_Module module, uint32 bitValue, uint32 brpeValue)
+{
+    CAN_PROFILE_FUNCTION(can_setBitTiming);
+    can_Regs* regs=CAN_REGS(module);
+    uint32 ctl=regs->CTL;
+    bool written;
+
+    bitValue &=CAN_BIT_TSEG2_M | CAN_BIT_TSEG1_M | CAN_BIT_SJW_M | CAN_BIT_BRP_M;
+    brpeValue &=CAN_BRPE_BRPE_M;
+    regs->CTL =ctl | CAN_CTL_INIT | CAN_CTL_CCE;
+    regs->BRPE =brpeValue;
+    regs->BIT =bitValue;
+    written=(regs->BIT == bitValue) && (regs->BRPE == brpeValue);
+    regs->CTL =ctl & ~(CAN_CTL_INIT | CAN_CTL_CCE);
+    return written;
+}
+/*
+ * Description : Function to read the bit timing a module is running with,
+ *  decoded from CANBIT/CANBRPE. The hardware does not separate the
+ *  propagation segment from phase 1, so propSeg is 0 and phaseSeg1 holds TSEG1.
+ *
+ *  Arguments: module, pointer to the structure to fill
+ */
+void can_getBitTiming(can_Module module, can_bitTiming* timingPtr)
+{
+    CAN_PROFILE_FUNCTION(can_getBitTiming);
+    can_Regs* regs=CAN_REGS(module);
+    uint32 bitValue=regs->BIT, brpeValue=regs->BRPE;
+    uint32 tseg1=((bitValue & CAN_BIT_TSEG1_M) >> CAN_BIT_TSEG1_S) + 1;
+    uint32 tseg2=((bitValue & CAN_BIT_TSEG2_M) >> CAN_BIT_TSEG2_S) + 1;
+    uint32 tolerance;
+
+    timingPtr->prescaler=(((brpeValue & CAN_BRPE_BRPE_M) << 6) | (bitValue & CAN_BIT_BRP_M)) + 1;
+    timingPtr->quanta=1 + tseg1 + tseg2;
+    timingPtr->propSeg=0;
+    timingPtr->phaseSeg1=tseg1;
+    timingPtr->phaseSeg2=tseg2;
+    timingPtr->sjw=((bitValue & CAN_BIT_SJW_M) >> CAN_BIT_SJW_S) + 1;
+    timingPtr->samplePoint=(uint16)((1 + tseg1)*1000/timingPtr->quanta);
+    timingPtr->bitRate=can_moduleClock[module]/((uint32)timingPtr->prescaler*timingPtr->quanta);
+    //oscillator tolerance conditions of the CAN specification
+    timingPtr->tolerance=(uint32)timingPtr->sjw*1000000/(20*timingPtr->quanta);
+    tolerance=(tseg1 < tseg2 ? tseg1 : tseg2)*1000000/(2*(13*timingPtr->quanta - tseg2));
+    if (tolerance < timingPtr->tolerance)
+    {
+        timingPtr->tolerance=tolerance;
+    }
+    timingPtr->BIT=bitValue;
+    timingPtr->BRPE=brpeValue;
+}
+/*
+ * Description : Function to transmit data objects
+ *
+ *  Arguments: pointer to structure holding the required info which are:
+ *                  can_Module module; //can0 or can1
+                    can_frameType frameType; //DATA OR REMOTE
+                    can_IdType ID_type;    //normal or extended
+                    uint32 ID_mask; //mask for acceptance filtering
+                    uint32 ID; //ID OF THE MESSAGE
+                    uint8 bytesNum; //no of bytes to be sent
+                    uint64 Data; //data to be sent
+                    uint8 messageNum; //data object number in the can ram
+ *  Returns: FALSE if the interface stayed busy, the frame is not sent then
+ */
+bool can_transmit(const can_transmitStruct* transmitPtr)
+{
+    CAN_PROFILE_FUNCTION(can_transmit);
+    can_ifRegs* ifRegs;
+    uint32 state;
+    bool written=FALSE;
+
+    state=CAN_ENTER_CRITICAL();
+    ifRegs=can_nextInterface(transmitPtr->module);
+    if (ifRegs != 0 && can_writeTransmit(ifRegs, transmitPtr))
+    {
+        can_txShadows[transmitPtr->module][(transmitPtr->messageNum-1) & 31].key=0;
+        written=TRUE;
+    }
+    CAN_EXIT_CRITICAL(state);
+    return written;
+}
+/*
+ * Description : Function to send several frames with as little register
+ *               traffic as possible. Frames are written alternately through
+ *               IF1 and IF2, so one interface is filled while the command
+ *               transfer of the other is running, and only the interface
+ *               about to be reused is waited on. An object already loaded by
+ *               this function with the same id, type, mask and length only
+ *               gets its data registers and TXRQST written.
+ *               Objects sent with this function must not be written by the
+ *               instance functions of CAN_DEFINE_INSTANCE.
+ *
+ *  Arguments: array of frames (messageNum selects the object of each), count
+ *  Returns: number of frames handed to the controller, less than count if
+ *           an interface stayed busy
+ */
+uint32 can_transmitBatch(const can_transmitStruct* frames, uint32 count)
+{
+    CAN_PROFILE_FUNCTION(can_transmitBatch);
+    const can_transmitStruct* frame;
+    can_txShadow* shadow;
+    can_updateStruct update;
+    can_ifRegs* ifRegs;
+    uint32 i, key, state;
+    bool written;
+
+    for (i=0; i<count; i++)
+    {
+        frame=&frames[i];
+        shadow=&can_txShadows[frame->module][(frame->messageNum-1) & 31];
+        key=CAN_TX_KEY_VALID | (frame->ID_type == extended ? CAN_TX_KEY_EXTENDED | (frame->ID & 0x1FFFFFFF) :
+                (frame->ID & 0x7FF)) | (frame->frameType == remote ? CAN_TX_KEY_REMOTE : 0);
+        state=CAN_ENTER_CRITICAL();
+        ifRegs=can_nextInterface(frame->module);
+        if (ifRegs == 0)
+        {
+            written=FALSE;
+        }
+        else if (shadow->key == key && shadow->mask == frame->ID_mask && shadow->bytesNum == frame->bytesNum)
+        {
+            update.module=frame->module;
+            update.bytesNum=frame->bytesNum;
+            update.Data=frame->Data;
+            update.messageNum=frame->messageNum;
+            written=can_writeUpdate(ifRegs, &update);
+        }
+        else
+        {
+            written=can_writeTransmit(ifRegs, frame);
+            shadow->key=written ? key : 0;
+            shadow->mask=frame->ID_mask;
+            shadow->bytesNum=frame->bytesNum;
+        }
+        CAN_EXIT_CRITICAL(state);
+        if (!written)
+        {
+            break;
+        }
+    }
+    return i;
+}
+/*
+ * Description : Function to update existing data objects, the first
+ *               bytesNum bytes are written, the others keep their value, and
+ *               the object is sent in the same command transfer
+ *
+ *  Arguments: pointer to structure holding the required info which are:
+ *                  can_Module module; //can0 or can1
+                    uint8 bytesNum;//length of the object
+                    uint64 Data;
+                    uint8 messageNum;
+     Returns: FALSE if the interface stayed busy, the object is not updated
+              then
+ */
+bool can_updateMessage(const can_updateStruct* updatePtr)
+{
+    CAN_PROFILE_FUNCTION(can_updateMessage);
+    can_ifRegs* ifRegs;
+    uint32 state;
+    bool written;
+
+    state=CAN_ENTER_CRITICAL();
+    ifRegs=can_nextInterface(updatePtr->module);
+    written=ifRegs != 0 && can_writeUpdate(ifRegs, updatePtr);
+    CAN_EXIT_CRITICAL(state);
+    return written;
+}
+/*
+ * Description : Function to configure received data objects, same as
+ *               can_configureReceive(): frames accepted by the object are
+ *               delivered through can_readFrame()
+ *
+ *  Arguments: pointer to structure holding the required info which are:
+ *                  can_Module module; //can0 or can1
+                    can_IdType ID_type;    //normal or extended
+                    uint32 ID_mask; //mask for acceptance filtering
+                    uint32 ID; //ID OF THE MESSAGE
+                    uint8 bytesNum; //no of bytes to be sent
+                    uint64 Data; //data to be sent
+                    uint8 messageNum; //data object number in the can ram
+ *  Returns: void
+ */
+void can_receive(const can_receiveStruct* receivePtr)
+{
+    CAN_PROFILE_FUNCTION(can_receive);
+    can_configureReceive(receivePtr);
+}
+/*
+ * Description : Function to enable test mode
  *
- *  Arguments: pointer to structure holding the required info
- *  Returns: returns false if the calculated values are not in the right range
- *           returns true if else
+ *  Arguments: pointer to structure holding the required info which are:
+ *
+                    can_Module module; //can0 or can1
+                    can_testingType mode;
+ *  Returns: FALSE if mode is not a can_testingType, nothing is written then
+ *           (the mode indexes the CANTST bits, so an out of range value
+ *           is refused instead of writing whatever follows the table)
  */
-bool can_init(const can_configStruct* configPtr)
+bool can_enableTestMode(const can_testingStruct* testingPtr)
 {
-    float32 bitTime, tq;
-    uint8 baudRatePrescalar, m_tprop,  tphase, tphase1, tphase2, tsync, TSEG1, TSEG2, tSJW=4;
-    //calculating bit time
-    bitTime= 1/(configPtr->bitRate);
-    //quantum time calculation
-    tq= bitTime/(configPtr->n);
-    //baud rate calculation
-    baudRatePrescalar=tq*(configPtr->Fsys);
-    //calculating tsync
-    tsync=1;
-    //calculating how many quantas is the delay
-    m_tprop=round((configPtr->delays)/tq);
-    //calculating how many quantas in tphase
-    tphase=(configPtr->n)-m_tprop-1;
-    if(tphase%2==0) //tphase is an even multiple of tq
-    {
-        tphase1=tphase/2;
-        tphase2=tphase1;
-    }
-    else
-    {
-        tphase1=tphase/2;
-        tphase2=tphase1+1;
-    }
-    //calculating values for CANBIT register
-    TSEG1=m_tprop+tphase1-tsync;
-    TSEG2=tphase2-1;
-    //i need to make sure that tSJW value is less than phase 1 and phase 2
-    while (tSJW> tphase1 || tSJW > tphase2)
-    {
-        tSJW--;
-    }
-    tSJW=tSJW-1;
-    baudRatePrescalar= baudRatePrescalar-1;
-    //check if the calculated values are in the correct range
-    if (tSJW <0 || tSJW >=4 || tphase1 <1 || tphase1 >8 || tphase2 <1 || tphase2 >8 ||
-            m_tprop <1 || m_tprop >8)
+    CAN_PROFILE_FUNCTION(can_enableTestMode);
+    //CANTST bits for receive, bitTiming, physicalHigh and physicalLow
+    static const uint32 testBits[]={CAN_TST_RX, CAN_TST_TX_SAMPLE, CAN_TST_TX_RECESSIVE, CAN_TST_TX_DOMINANT};
+    can_Regs* regs=CAN_REGS(testingPtr->module);
+
+    if ((uint32)testingPtr->mode >= sizeof(testBits)/sizeof(testBits[0]))
     {
         return FALSE;
     }
+    regs->CTL |= CAN_CTL_TEST;
+    //the TX field selects one pin state, a previous one is replaced
+    regs->TST = (regs->TST & ~CAN_TST_TX_M) | testBits[testingPtr->mode];
+    return TRUE;
+}
+/*
+ * Description : Function to enable silent mode
+ *
+ *  Arguments: pointer to enum holding the required info which are:
+ *
+                    can_Module module; //can0 or can1
 
-    if (configPtr->module==0)
-    {   //initialize clk for can0
-        SYSCTL_RCGC0_R |= SYSCTL_RCGC0_CAN0;
-
-        //GPIO Configuration
-        //for CAN0 we will use port B
-        //first we need to enable the clk for the port
-        SYSCTL_RCGC2_R |=SYSCTL_RCGC2_GPIOB;
-        //set the alternate function
-        GPIO_PORTB_AFSEL_R |=0x30;
-        //set the function to can0
-        GPIO_PORTB_PCTL_R &=~0X00FF0000;
-        GPIO_PORTB_PCTL_R |=0X00880000;
-        //disable the analog function and enable the digital function
-        GPIO_PORTB_AMSEL_R &= ~0x30;
-        GPIO_PORTB_DEN_R |= 0x30;
-        // set init to enter initialization state and CCE bits to access CANBIT register
-        //set CANBRPE register to be able to configure the baud rate prescalar
-        CAN0_CTL_R |=0x41;
-        CAN0_BRPE_R=0XF;
-        //setting the values in CANBIT register
-        CAN0_BIT_R |=baudRatePrescalar;
-        CAN0_BIT_R |=tSJW<<6;
-        CAN0_BIT_R |=TSEG1<<8;
-        CAN0_BIT_R |=TSEG2<<12;
-
-        //clear init bit to exit initialization state
-        CAN0_CTL_R &=~0x41;
-        //ENABLE INTERRUPTS
-        CAN0_CTL_R |=0x06;
+ *  Returns: void
+ */
+void can_enableSilentMode(const can_Module* module)
+{
+    CAN_PROFILE_FUNCTION(can_enableSilentMode);
+    can_Regs* regs=CAN_REGS(*module);
 
-    }
-    if (configPtr ->module==1)
-    {
-        //initialize clk for can1
-        SYSCTL_RCGC0_R |= SYSCTL_RCGC0_CAN1;
-        //GPIO configuration
-        //first we need to enable the clk for the port
-        SYSCTL_RCGC2_R |=SYSCTL_RCGC2_GPIOA;
-        //set the alternate function
-        GPIO_PORTA_AFSEL_R |=0x03;
-        //set the function to can0
-        GPIO_PORTA_PCTL_R &=~0X000000FF;
-        GPIO_PORTA_PCTL_R |=0X00000088;
-        //diable the analog function and enable the digital function
-        GPIO_PORTA_AMSEL_R &= ~0x03;
-        GPIO_PORTA_DEN_R |= 0x03;
-        // set init and CCE bits to access CANBIT register
-        //set CANBRPE register to be able to configure the baud rate prescalar
-        CAN1_CTL_R |=0x41;
-        CAN1_BRPE_R=0XF;
-        //setting the values in CANBIT register
-        CAN1_BIT_R |=baudRatePrescalar;
-        CAN1_BIT_R |=tSJW;
-        CAN1_BIT_R |=TSEG1;
-        CAN1_BIT_R |=TSEG2;
-        //clear init bit to exit initialization state
-        CAN1_CTL_R &=~0x41;
- //ENABLE INTERRUPTS
-        CAN1_CTL_R |=0x06;
-
-
-    }
-  
-    return TRUE;
+    regs->CTL |= CAN_CTL_TEST;
+    regs->TST |=CAN_TST_SILENT;
+}
+/*
+ * Description : Function to enable loopback mode
+ *
+ *  Arguments: pointer to enum holding the required info which are:
+ *
+                    can_Module module; //can0 or can1
 
+ *  Returns: void
+ */
+void can_enableLoopBackMode(const can_Module* module)
+{
+    CAN_PROFILE_FUNCTION(can_enableLoopBackMode);
+    can_Regs* regs=CAN_REGS(*module);
 
+    regs->CTL |= CAN_CTL_TEST;
+    regs->TST |=CAN_TST_LBACK;
 }
 /*
- * Description : Function to transmit data objects
+ * Description : Function to configure a message object for interrupt driven
+ *               reception, frames accepted by it are put in the module ring
+ *               by the ISR and read with can_readFrame(). The object is
+ *               written through the next free interface with interrupts
+ *               masked, so it may be called while the ISR is enabled.
  *
  *  Arguments: pointer to structure holding the required info which are:
- *                  can_Interface interface; //CANIF1 or CANIF2
-                    can_Module module; //can0 or can1
-                    can_frameType frameType; //DATA OR REMOTE
+ *                  can_Module module; //can0 or can1
                     can_IdType ID_type;    //normal or extended
                     uint32 ID_mask; //mask for acceptance filtering
                     uint32 ID; //ID OF THE MESSAGE
-                    uint8 bytesNum; //no of bytes to be sent
-                    uint64 Data; //data to be sent
+                    uint8 bytesNum; //no of bytes expected
                     uint8 messageNum; //data object number in the can ram
  *  Returns: void
  */
-void can_transmit(const can_transmitStruct* transmitPtr)
+void can_configureReceive(const can_receiveStruct* receivePtr)
 {
-    if (transmitPtr->module == 0) //CAN0
-    {
-        if(transmitPtr->interface == 1) //CANIF1
+    CAN_PROFILE_FUNCTION(can_configureReceive);
+    can_ifRegs* ifRegs;
+    uint32 state;
 
+    state=CAN_ENTER_CRITICAL();
+    ifRegs=can_nextInterface(receivePtr->module);
+    if (ifRegs != 0)
+    {
+        //not using fifo
+        can_writeReceive(ifRegs, receivePtr, receivePtr->messageNum, TRUE);
+    }
+    CAN_EXIT_CRITICAL(state);
+}
+/*
+ * Description : Function to receive a burst of frames with one filter: depth
+ *               consecutive objects of the fifo pool get the same id and mask,
+ *               EOB is set only on the last one. The controller stores each
+ *               frame in the lowest member without new data and the ISR
+ *               drains the members in ascending order into the ring, so
+ *               frames come out of can_readFrame() in arrival order.
+ *
+ *  Arguments: same structure as can_configureReceive() (messageNum is not
+ *             used), number of objects 1..32
+ *  Returns: first (lowest) object of the fifo, CAN_NO_OBJECT if the fifo
+ *           pool has no run of depth free objects or an interface stayed
+ *           busy (the members written are then invalidated and freed, a
+ *           member that could not be invalidated stays allocated)
+ */
+can_objectHandle can_configureRxFifo(const can_receiveStruct* receivePtr, uint8 depth)
+{
+    CAN_PROFILE_FUNCTION(can_configureRxFifo);
+    can_Module module=receivePtr->module;
+    can_ifRegs* ifRegs;
+    can_objectHandle first;
+    uint32 state, members, kept=0;
+    uint8 i;
+
+    if (depth < 1 || depth > 32)
+    {
+        return CAN_NO_OBJECT;
+    }
+    first=can_allocRun(module, poolFifo, depth);
+    if (first == CAN_NO_OBJECT)
+    {
+        return CAN_NO_OBJECT;
+    }
+    members=(uint32)CAN_OBJECT_RANGE(first, depth);
+    state=CAN_ENTER_CRITICAL();
+    can_fifoObjects[module] |=members;
+    can_fifoEnds[module] |=1UL<<(first+depth-2);
+    CAN_EXIT_CRITICAL(state);
+    for (i=0; i<depth; i++)
+    {
+        state=CAN_ENTER_CRITICAL();
+        ifRegs=can_nextInterface(module);
+        if (ifRegs != 0)
         {
-            while(CAN0_IF1CRQ_R & 0x00008000); //wait while can0-if1 is busy
-
-            CAN0_IF1CMSK_R |=0XF3; /* WRNRD=1 to write in the register
-                                      MASK, ARB, CONTROL, DATA A, DATA B=1 to
-                                      to transfer them to the interface registers to be
-                                      able to access them by the cpu */
-            //in order for bits to be used for acceptance filtering we have to enable
-
-            // CAN0_IF1MCTL_R |=0x1000;
-            if(transmitPtr->ID_type == 0) // 11 bit id
-            {   /* if we use 11 bit id we have to shift the value by 2 because
-                    the value is stored in bits 2:12 in the following registers */
-                CAN0_IF1MSK2_R |= (transmitPtr->ID_mask)<<2; // acceptance filter mask
-                CAN0_IF1ARB2_R  |=(transmitPtr->ID)<<2;      // message id
-                CAN0_IF1ARB2_R  |= 0xA000;      //to set direction of transmission and validation bit
-                CAN0_IF1ARB2_R &=~0x4000;       //clear the xtd bit
-
-
-            }
-            else //29 bit id
-            {   /* for 29 bit id, the first register stores the first 16 bit of the id mask or id
-                    and the other register stores the rest so we have to shift the other bits */
-                CAN0_IF1MSK1_R |= (transmitPtr->ID_mask);
-                CAN0_IF1MSK2_R |= (transmitPtr->ID_mask)>>16;
-                CAN0_IF1ARB1_R  |=(transmitPtr->ID);
-                CAN0_IF1ARB2_R  |=(transmitPtr->ID)>>16;
-                CAN0_IF1ARB2_R  |= 0xE000; //set the direction, validation, extended frame bit.
-
-            }
-            CAN0_IF1MCTL_R |= 0x3080; //enable interrupt for this message object, not using fifo, unmask bit
-            CAN0_IF1MCTL_R |= (transmitPtr->bytesNum); //the number of bytes to be transmitted
-            //  while (!( CAN0_IF1MCTL_R & 0x0100); //if no message request
-            CAN0_IF1DA1_R |= transmitPtr->Data;     //first 2 bytes of data
-            if(transmitPtr->bytesNum > 2 )
-            {
-                CAN0_IF1DA2_R |= (transmitPtr->Data)>>16;
-            }
-            if(transmitPtr->bytesNum > 4 )
-            {
-                CAN0_IF1DB1_R |= (transmitPtr->Data)>>16;
-            }
-            if(transmitPtr->bytesNum > 6)
-            {
-                CAN0_IF1DB2_R |= (transmitPtr->Data)>>16;
-            }
-            if(transmitPtr->frameType == 1) //remote frame
+            can_writeReceive(ifRegs, receivePtr, first+i, i == depth-1);
+        }
+        CAN_EXIT_CRITICAL(state);
+        if (ifRegs == 0)
+        {
+            //an interface stayed busy: undo the members already written
+            state=CAN_ENTER_CRITICAL();
+            while (i-- > 0)
             {
-                CAN0_IF1MCTL_R |= 0x0200; //when receiving a remote frame start transmitting automatically
+                if (!can_invalidateObject(module, first+i))
+                {
+                    kept |=1UL<<(first+i-1); //still valid, not handed out again
+                }
             }
-            CAN0_IF1CRQ_R |= transmitPtr->messageNum; //select the message num in the can ram
-            CAN0_IF1MCTL_R |= 0x0100; //set the TXRQST bit to start transmission
+            can_fifoObjects[module] &=~members;
+            can_fifoEnds[module] &=~members;
+            can_objectsInUse[module] &=~members | kept;
+            CAN_EXIT_CRITICAL(state);
+            return CAN_NO_OBJECT;
         }
-        else if(transmitPtr->interface == 2)
-
-        {
-            while(CAN0_IF2CRQ_R & 0x00008000); //wait while can0-if1 is busy
+    }
+    return first;
+}
+/*
+ * Description : Function to take the oldest received frame out of the ring,
+ *               never blocks
+ *
+ *  Arguments: module to read from, pointer to the frame to fill
+ *  Returns: FALSE if no frame was received
+ */
+bool can_readFrame(can_Module module, can_frame* framePtr)
+{
+    CAN_PROFILE_FUNCTION(can_readFrame);
+    const can_frame* slot=can_peekFrame(module);
 
-            CAN0_IF2CMSK_R |=0XF3;
-            //in order for these bits to be used for acceptance filtering
-            //CAN0_IF2MCTL_R |=0x1000;
-            if(transmitPtr->ID_type == 0) // 11 bit id
-            {
-                CAN0_IF2MSK2_R |= (transmitPtr->ID_mask)<<2;
-                CAN0_IF2ARB2_R  |=(transmitPtr->ID)<<2;
-                CAN0_IF2ARB2_R  |= 0xA000; //to set direction of transmission and validation bit
-                CAN0_IF2ARB2_R &=~0x4000; //clear the xtd bit
+    if (slot == 0)
+    {
+        return FALSE;
+    }
+    *framePtr=*slot;
+    can_releaseFrame(module);
+    return TRUE;
+}
+/*
+ * Description : Function to look at the oldest received frame in place,
+ *               never blocks. The slot stays owned by the caller, and is not
+ *               overwritten by the ISR, until can_releaseFrame() is called;
+ *               peeking again before that gives the same frame.
+ *
+ *  Arguments: module to read from
+ *  Returns: pointer to the frame in the ring, 0 if no frame was received
+ */
+const can_frame* can_peekFrame(can_Module module)
+{
+    CAN_PROFILE_FUNCTION(can_peekFrame);
+    can_rxRing* ring=&can_rxRings[module];
+    uint32 tail=ring->tail;
 
+    if (ring->head == tail)
+    {
+        return 0;
+    }
+    CAN_BARRIER();
+    return &ring->frame[tail & (CAN_RX_RING_SIZE-1)];
+}
+/*
+ * Description : Function to give the frame returned by can_peekFrame() back
+ *               to the ISR, the pointer must not be used afterwards
+ *
+ *  Arguments: module
+ *  Returns: void
+ */
+void can_releaseFrame(can_Module module)
+{
+    CAN_PROFILE_FUNCTION(can_releaseFrame);
+    can_rxRing* ring=&can_rxRings[module];
+    uint32 tail=ring->tail;
 
-            }
-            else //29 bit id
-            {
-                CAN0_IF2MSK1_R |= (transmitPtr->ID_mask);
-                CAN0_IF2MSK2_R |= (transmitPtr->ID_mask)>>16;
-                CAN0_IF2ARB1_R  |=(transmitPtr->ID);
-                CAN0_IF2ARB2_R  |=(transmitPtr->ID)>>16;
-                CAN0_IF2ARB2_R  |= 0xE000;
+    if (ring->head == tail)
+    {
+        return;
+    }
+    CAN_BARRIER();
+    ring->tail=tail+1;
+}
+/*
+ * Description : Function to get the number of frames waiting in the ring
+ *
+ *  Arguments: module
+ *  Returns: number of frames
+ */
+uint32 can_rxPending(can_Module module)
+{
+    CAN_PROFILE_FUNCTION(can_rxPending);
+    return can_rxRings[module].head - can_rxRings[module].tail;
+}
+/*
+ * Description : Function to get the number of frames dropped because the
+ *               ring was full
+ *
+ *  Arguments: module
+ *  Returns: number of dropped frames
+ */
+uint32 can_rxOverflows(can_Module module)
+{
+    CAN_PROFILE_FUNCTION(can_rxOverflows);
+    return can_rxRings[module].overflows;
+}
+/*
+ * Description : Function to get the number of status values and sent frames
+ *               not passed to their callback because can_process() did not
+ *               run before CAN_EVENT_RING_SIZE of them were waiting
+ *
+ *  Arguments: module
+ *  Returns: number of dropped events
+ */
+uint32 can_eventOverflows(can_Module module)
+{
+    CAN_PROFILE_FUNCTION(can_eventOverflows);
+    return can_events[module].overflows;
+}
+/*
+ * Description : Function to call a function for received frames of an id or
+ *               group of ids, on both modules. A standard id costs one table
+ *               read in can_dispatch(), an exact extended id (mask
+ *               0x1FFFFFFF) a binary search, a masked extended filter is
+ *               compared after them in registration order. A later
+ *               registration replaces the handler of the ids it covers.
+ *
+ *  Arguments: id type, id, mask (set bits must match), handler (0 removes
+ *             the handler of these ids; a function left without ids gives
+ *             its slot back for later registrations)
+ *  Returns: FALSE if CAN_HANDLERS functions, CAN_EXT_HANDLER_IDS extended
+ *           ids or CAN_EXT_HANDLER_MASKS extended filters are already taken
+ */
+bool can_registerHandler(can_IdType ID_type, uint32 ID, uint32 ID_mask, can_rxHandler handler)
+{
+    CAN_PROFILE_FUNCTION(can_registerHandler);
+    uint8 slot=0;
+    uint32 i, state;
 
-            }
-            CAN0_IF2MCTL_R |= 0x3080;
-            CAN0_IF2MCTL_R |= (transmitPtr->bytesNum);
-            //  while (!( CAN0_IF1MCTL_R & 0x0100); //if no message request
-            CAN0_IF2DA1_R |= transmitPtr->Data;
-            if(transmitPtr->bytesNum > 2 )
+    if (handler != 0 && (slot=can_handlerSlot(handler)) == 0)
+    {
+        return FALSE;
+    }
+    if (ID_type == normal)
+    {
+        ID &=0x7FF;
+        ID_mask &=0x7FF;
+        for (i=0; i<2048; i++)
+        {
+            if (((i ^ ID) & ID_mask) == 0)
             {
-                CAN0_IF2DA2_R |= (transmitPtr->Data)>>16;
+                can_stdHandler[i]=slot;
             }
-            if(transmitPtr->bytesNum > 4 )
+        }
+        return TRUE;
+    }
+    ID &=0x1FFFFFFF;
+    ID_mask &=0x1FFFFFFF;
+    state=CAN_ENTER_CRITICAL();
+    if (ID_mask == 0x1FFFFFFF)
+    {
+        i=can_extHandlerSearch(ID);
+        if (i < can_extHandlerIdCount && can_extHandlerIds[i].ID == ID)
+        {
+            if (slot != 0)
             {
-                CAN0_IF2DB1_R |= (transmitPtr->Data)>>16;
+                can_extHandlerIds[i].handler=slot;
             }
-            if(transmitPtr->bytesNum > 6)
+            else
             {
-                CAN0_IF2DB2_R |= (transmitPtr->Data)>>16;
+                can_extHandlerIdCount--;
+                for (; i<can_extHandlerIdCount; i++)
+                {
+                    can_extHandlerIds[i]=can_extHandlerIds[i+1];
+                }
             }
-            if(transmitPtr->frameType == 1)
+        }
+        else if (slot != 0)
+        {
+            if (can_extHandlerIdCount == CAN_EXT_HANDLER_IDS)
             {
-                CAN0_IF1MCTL_R |= 0x0200;
+                CAN_EXIT_CRITICAL(state);
+                return FALSE;
             }
-            CAN0_IF2CRQ_R |= transmitPtr->messageNum;
-            CAN0_IF2MCTL_R |= 0x0100;
+            memmove(&can_extHandlerIds[i+1], &can_extHandlerIds[i],
+                    (can_extHandlerIdCount-i)*sizeof(can_extHandlerId));
+            can_extHandlerIds[i].ID=ID;
+            can_extHandlerIds[i].handler=slot;
+            can_extHandlerIdCount++;
         }
-
-
-
+        CAN_EXIT_CRITICAL(state);
+        return TRUE;
     }
-    else  if (transmitPtr->module == 1)
+    for (i=0; i<can_extHandlerMaskCount; i++)
     {
-        if(transmitPtr->interface == 1)
-
+        if (can_extHandlerMasks[i].ID == (ID & ID_mask) && can_extHandlerMasks[i].mask == ID_mask)
         {
-            while(CAN1_IF1CRQ_R & 0x00008000); //wait while can0-if1 is busy
-
-            CAN1_IF1CMSK_R |=0XF3;
-            //in order for these bits to be used for acceptance filtering
-            //CAN1_IF1MCTL_R |=0x1000;
-            if(transmitPtr->ID_type == 0) // 11 bit id
+            break;
+        }
+    }
+    if (slot == 0)
+    {
+        if (i < can_extHandlerMaskCount)
+        {
+            can_extHandlerMaskCount--;
+            for (; i<can_extHandlerMaskCount; i++)
             {
-                CAN1_IF1MSK2_R |= (transmitPtr->ID_mask)<<2;
-                CAN1_IF1ARB2_R  |=(transmitPtr->ID)<<2;
-                CAN1_IF1ARB2_R  |= 0xA000; //to set direction of transmission and validation bit
-                CAN1_IF1ARB2_R &=~0x4000; //clear the xtd bit
-
-
+                can_extHandlerMasks[i]=can_extHandlerMasks[i+1];
             }
-            else //29 bit id
-            {   CAN1_IF1MSK1_R |= (transmitPtr->ID_mask);
-            CAN1_IF1MSK2_R |= (transmitPtr->ID_mask)>>16;
-            CAN1_IF1ARB1_R  |=(transmitPtr->ID);
-            CAN1_IF1ARB2_R  |=(transmitPtr->ID)>>16;
-            CAN1_IF1ARB2_R  |= 0xE000;
+        }
+    }
+    else if (i < can_extHandlerMaskCount || can_extHandlerMaskCount < CAN_EXT_HANDLER_MASKS)
+    {
+        can_extHandlerMasks[i].ID=ID & ID_mask;
+        can_extHandlerMasks[i].mask=ID_mask;
+        can_extHandlerMasks[i].handler=slot;
+        if (i == can_extHandlerMaskCount)
+        {
+            can_extHandlerMaskCount++;
+        }
+    }
+    else
+    {
+        CAN_EXIT_CRITICAL(state);
+        return FALSE;
+    }
+    CAN_EXIT_CRITICAL(state);
+    return TRUE;
+}
+/*
+ * Description : Function to hand received frames to their handlers, each
+ *               frame is passed in place from the ring and released once its
+ *               handler returns. Frames without a handler are dropped, so
+ *               can_readFrame() is not to be used on a dispatched module.
+ *
+ *  Arguments: module, maximum number of frames to take out of the ring
+ *  Returns: number of frames taken out of the ring
+ */
+uint32 can_dispatch(can_Module module, uint32 maxFrames)
+{
+    CAN_PROFILE_FUNCTION(can_dispatch);
+    const can_frame* framePtr;
+    can_rxHandler handler;
+    uint32 frames=0;
 
-            }
-            CAN1_IF1MCTL_R |= 0x3080;
-            CAN1_IF1MCTL_R |= (transmitPtr->bytesNum);
-            //  while (!( CAN0_IF1MCTL_R & 0x0100); //if no message request
-            CAN1_IF1DA1_R |= transmitPtr->Data;
-            if(transmitPtr->bytesNum > 2 )
-            {
-                CAN1_IF1DA2_R |= (transmitPtr->Data)>>16;
-            }
-            if(transmitPtr->bytesNum > 4 )
-            {
-                CAN1_IF1DB1_R |= (transmitPtr->Data)>>16;
-            }
-            if(transmitPtr->bytesNum > 6)
-            {
-                CAN1_IF1DB2_R |= (transmitPtr->Data)>>16;
-            }
-            if(transmitPtr->frameType == 1)
-            {
-                CAN0_IF1MCTL_R |= 0x0200;
-            }
-            CAN1_IF1CRQ_R |= transmitPtr->messageNum;
-            CAN1_IF1MCTL_R |= 0x0100;
+    while (frames < maxFrames && (framePtr=can_peekFrame(module)) != 0)
+    {
+        handler=can_findHandler(framePtr);
+        if (handler != 0)
+        {
+            handler(module, framePtr);
         }
-        else if(transmitPtr->interface == 2)
+        can_releaseFrame(module);
+        frames++;
+    }
+    return frames;
+}
+/*
+ * Description : passes the status values and sent frames left by the ISR to
+ *               the callbacks set now
+ */
+static void can_runCallbacks(can_Module module)
+{
+    can_eventRing* events=&can_events[module];
+    can_statusCallback statusCallback;
+    can_txCallback txCallback;
 
+    while (events->statusTail != events->statusHead)
+    {
+        CAN_BARRIER();
+        statusCallback=can_statusCallbacks[module];
+        if (statusCallback != 0)
+        {
+            statusCallback(module, events->status[events->statusTail & (CAN_EVENT_RING_SIZE-1)]);
+        }
+        CAN_BARRIER();
+        events->statusTail++;
+    }
+    while (events->sentTail != events->sentHead)
+    {
+        CAN_BARRIER();
+        txCallback=can_txQueues[module].callback;
+        if (txCallback != 0)
         {
-            while(CAN1_IF2CRQ_R & 0x00008000); //wait while can0-if1 is busy
+            txCallback(module, &events->sent[events->sentTail & (CAN_EVENT_RING_SIZE-1)]);
+        }
+        CAN_BARRIER();
+        events->sentTail++;
+    }
+}
+/*
+ * Description : Function to run the deferred (bottom half) work of both
+ *               modules: a module whose bus-off back-off is over is put back
+ *               on the bus, the status and transmit callbacks are called for
+ *               the events left by the ISR, received frames are dispatched
+ *               to their handlers, the modules taking turns to be served
+ *               first. Called from the
+ *               main loop, or from PendSV_Handler / the CAN_DEFER_IRQ handler
+ *               with CAN_DEFER_MODE 1 / 2; it signals itself again if frames
+ *               are left once maxFrames is reached.
+ *
+ *  Arguments: maximum number of frames to dispatch
+ *  Returns: number of frames dispatched
+ */
+uint32 can_process(uint32 maxFrames)
+{
+    CAN_PROFILE_FUNCTION(can_process);
+    can_Module first=(can_Module)can_processFirst;
+    uint32 frames;
+    uint8 module;
 
-            CAN1_IF2CMSK_R |=0XF3;
-            //in order for these bits to be used for acceptance filtering
-            // CAN1_IF2MCTL_R |=0x1000;
-            if(transmitPtr->ID_type == 0) // 11 bit id
-            {
-                CAN1_IF2MSK2_R |= (transmitPtr->ID_mask)<<2;
-                CAN1_IF2ARB2_R  |=(transmitPtr->ID)<<2;
-                CAN1_IF2ARB2_R  |= 0xA000; //to set direction of transmission and validation bit
-                CAN1_IF2ARB2_R &=~0x4000; //clear the xtd bit
+    for (module=0; module<2; module++)
+    {
+        if (can_busOffDue(&can_busOffs[module]))
+        {
+            can_busOffRecover((can_Module)module);
+        }
+        can_runCallbacks((can_Module)module);
+    }
+    can_processFirst ^=1;
+    frames=can_dispatch(first, maxFrames);
+    frames +=can_dispatch((can_Module)(first ^ 1), maxFrames-frames);
+    if (frames == maxFrames && (can_rxPending(module0) != 0 || can_rxPending(module1) != 0))
+    {
+        CAN_DEFER_SIGNAL();
+    }
+    return frames;
+}
+/*
+ * Description : Function to read the worst case cost of the ISR of a module
+ *
+ *  Arguments: module, pointer to the structure to fill, TRUE to start a new
+ *             measurement
+ *  Returns: void
+ */
+void can_getIsrLoad(can_Module module, can_isrLoad* loadPtr, bool reset)
+{
+    CAN_PROFILE_FUNCTION(can_getIsrLoad);
+    uint32 state;
 
+    state=CAN_ENTER_CRITICAL();
+    *loadPtr=can_isrLoads[module];
+    if (reset)
+    {
+        memset(&can_isrLoads[module], 0, sizeof(can_isrLoad));
+    }
+    CAN_EXIT_CRITICAL(state);
+}
+/*
+ * Description : Function to take a consistent copy of the bus health
+ *               counters of a module, e.g. to raise an alarm when the error
+ *               codes or the peak counters grow between two snapshots
+ *
+ *  Arguments: module, pointer to the structure to fill, TRUE to clear the
+ *             counters
+ *  Returns: void
+ */
+void can_getStats(can_Module module, can_stats* statsPtr, bool reset)
+{
+    CAN_PROFILE_FUNCTION(can_getStats);
+    uint32 state;
 
-            }
-            else //29 bit id
-            {   CAN1_IF2MSK1_R |= (transmitPtr->ID_mask);
-            CAN1_IF2MSK2_R |= (transmitPtr->ID_mask)>>16;
-            CAN1_IF2ARB1_R  |=(transmitPtr->ID);
-            CAN1_IF2ARB2_R  |=(transmitPtr->ID)>>16;
-            CAN1_IF2ARB2_R  |= 0xE000;
+    state=CAN_ENTER_CRITICAL();
+    *statsPtr=can_moduleStats[module];
+    if (reset)
+    {
+        memset(&can_moduleStats[module], 0, sizeof(can_stats));
+    }
+    CAN_EXIT_CRITICAL(state);
+}
+/*
+ * Description : Function to add an id to the set a module listens to through
+ *               can_filterApply(), takes effect on frames read after it
+ *
+ *  Arguments: module, id type, id
+ *  Returns: FALSE if CAN_FILTER_IDS ids were already added
+ */
+bool can_filterAdd(can_Module module, can_IdType ID_type, uint32 ID)
+{
+    CAN_PROFILE_FUNCTION(can_filterAdd);
+    uint32 slot, state;
+    bool added=TRUE;
 
-            }
-            CAN1_IF2MCTL_R |= 0x3080;
-            CAN1_IF2MCTL_R |= (transmitPtr->bytesNum);
-            //  while (!( CAN0_IF1MCTL_R & 0x0100); //if no message request
-            CAN1_IF2DA1_R |= transmitPtr->Data;
-            if(transmitPtr->bytesNum > 2 )
+    state=CAN_ENTER_CRITICAL();
+    if (ID_type == normal)
+    {
+        ID &=0x7FF;
+        if (!(can_stdFilter[module][ID>>5] & 1UL<<(ID & 31)))
+        {
+            if (can_filterIdCount[module] < CAN_FILTER_IDS)
             {
-                CAN1_IF2DA2_R |= (transmitPtr->Data)>>16;
+                can_stdFilter[module][ID>>5] |=1UL<<(ID & 31);
+                can_filterIdCount[module]++;
             }
-            if(transmitPtr->bytesNum > 4 )
+            else
             {
-                CAN1_IF2DB1_R |= (transmitPtr->Data)>>16;
+                added=FALSE;
             }
-            if(transmitPtr->bytesNum > 6)
+        }
+    }
+    else
+    {
+        ID &=0x1FFFFFFF;
+        for (slot=can_extFilterSlot(ID); can_extFilter[module][slot] != 0 &&
+                can_extFilter[module][slot] != (ID | CAN_FILTER_USED); slot=(slot+1) & (CAN_FILTER_EXT_SLOTS-1));
+        if (can_extFilter[module][slot] == 0)
+        {
+            if (can_filterIdCount[module] < CAN_FILTER_IDS)
             {
-                CAN1_IF2DB2_R |= (transmitPtr->Data)>>16;
+                can_extFilter[module][slot]=ID | CAN_FILTER_USED;
+                can_filterIdCount[module]++;
             }
-            if(transmitPtr->frameType == 1)
+            else
             {
-                CAN0_IF1MCTL_R |= 0x0200;
+                added=FALSE;
             }
-            CAN1_IF2CRQ_R |= transmitPtr->messageNum;
-            CAN1_IF2MCTL_R |= 0x0100;
         }
-
-
-
     }
+    CAN_EXIT_CRITICAL(state);
+    return added;
 }
 /*
- * Description : Function to update existing data objects
+ * Description : Function to configure receive objects for the ids added with
+ *               can_filterAdd(). can_computeMasks() covers the standard and
+ *               the extended ids with at most objects wide masks (split in
+ *               proportion to the number of ids of each type), the objects
+ *               are taken from the rx pool and the ids the masks accept
+ *               beyond the set are dropped by the ISR with a bit test or a
+ *               hash lookup. The objects of a previous call are freed once
+ *               the new ones are allocated, so they keep receiving until
+ *               then and stay in place when the call fails. Not reentrant.
  *
- *  Arguments: pointer to structure holding the required info which are:
- *                  can_Interface interface;
-                    can_Module module; //can0 or can1
-                    uint8 bytesNum;//bytes that need to be updated
-                    uint64 Data;
-                    uint8 messageNum;
-     Returns: void
+ *  Arguments: module, number of message objects to use
+ *  Returns: number of objects configured, 0 if there is no id or the rx pool
+ *           has fewer than objects free objects besides those of the
+ *           previous call (or objects is below 2 with both id types)
  */
-void can_updateMessage(const can_updateStruct* updatePtr)
+uint8 can_filterApply(can_Module module, uint8 objects)
 {
-    if(updatePtr->module == 0)
+    CAN_PROFILE_FUNCTION(can_filterApply);
+    can_receiveStruct receive;
+    const can_idMask* cube;
+    uint32 stdCount=0, extCount=0, extFirst, stdObjects, used, available, i, state;
+    uint32 previous, allocated=0;
+
+    state=CAN_ENTER_CRITICAL();
+    for (i=0; i<2048; i++)
     {
-        if(updatePtr->interface == 1)
+        if ((can_stdFilter[module][i>>5]>>(i & 31)) & 1)
         {
-            while(CAN0_IF1CRQ_R & 0x00008000); //wait while can0-if1 is busy
-
-            CAN0_IF1CMSK_R |=0X83; //set wren, dataa, datab bits
-            CAN0_IF1DA1_R |= updatePtr->Data; //update data
-            if(updatePtr->bytesNum > 2 )
-            {
-                CAN0_IF1DA2_R |= (updatePtr->Data)>>16;
-            }
-            if(updatePtr->bytesNum > 4 )
-            {
-                CAN0_IF1DB1_R |= (updatePtr->Data)>>16;
-            }
-            if(updatePtr->bytesNum > 6)
-            {
-                CAN0_IF1DB2_R |= (updatePtr->Data)>>16;
-            }
-
-            CAN0_IF1CRQ_R |= updatePtr->messageNum; //select the message num in the can ram
-            CAN0_IF1MCTL_R |= 0x0100; //set the TXRQST bit to start transmission
+            can_filterIds[stdCount++]=i;
         }
-        else
+    }
+    for (i=0; i<CAN_FILTER_EXT_SLOTS; i++)
+    {
+        if (can_extFilter[module][i] != 0)
         {
-            while(CAN0_IF2CRQ_R & 0x00008000); //wait while can0-if1 is busy
-
-            CAN0_IF2CMSK_R |=0X83;
-            CAN0_IF2DA1_R |= updatePtr->Data;
-            if(updatePtr->bytesNum > 2 )
-            {
-                CAN0_IF2DA2_R |= (updatePtr->Data)>>16;
-            }
-            if(updatePtr->bytesNum > 4 )
-            {
-                CAN0_IF2DB1_R |= (updatePtr->Data)>>16;
-            }
-            if(updatePtr->bytesNum > 6)
-            {
-                CAN0_IF2DB2_R |= (updatePtr->Data)>>16;
-            }
-
-            CAN0_IF2CRQ_R |= updatePtr->messageNum; //select the message num in the can ram
-            CAN0_IF2MCTL_R |= 0x0100; //set the TXRQST bit to start transmission
+            can_filterIds[stdCount+extCount++]=can_extFilter[module][i] & ~CAN_FILTER_USED;
         }
     }
-    if(updatePtr->module == 1)
+    available=can_poolMask[poolRx] & ~can_objectsInUse[module];
+    CAN_EXIT_CRITICAL(state);
+    for (used=0; available; used++)
+    {
+        available &=available-1;
+    }
+    if (stdCount+extCount == 0 || objects > used || objects < (stdCount != 0) + (extCount != 0))
+    {
+        return 0;
+    }
+    stdObjects=0;
+    if (stdCount != 0)
     {
-        if(updatePtr->interface == 1)
+        stdObjects=(objects*stdCount + (stdCount+extCount)/2)/(stdCount+extCount);
+        if (stdObjects < 1)
         {
-            while(CAN1_IF1CRQ_R & 0x00008000); //wait while can0-if1 is busy
-
-            CAN1_IF1CMSK_R |=0X83;
-            CAN1_IF1DA1_R |= updatePtr->Data;
-            if(updatePtr->bytesNum > 2 )
-            {
-                CAN1_IF1DA2_R |= (updatePtr->Data)>>16;
-            }
-            if(updatePtr->bytesNum > 4 )
-            {
-                CAN1_IF1DB1_R |= (updatePtr->Data)>>16;
-            }
-            if(updatePtr->bytesNum > 6)
-            {
-                CAN1_IF1DB2_R |= (updatePtr->Data)>>16;
-            }
-
-            CAN0_IF1CRQ_R |= updatePtr->messageNum; //select the message num in the can ram
-            CAN1_IF1MCTL_R |= 0x0100; //set the TXRQST bit to start transmission
+            stdObjects=1;
         }
-        else
+        if (extCount != 0 && stdObjects > objects-1u)
         {
-            while(CAN1_IF2CRQ_R & 0x00008000); //wait while can0-if1 is busy
-
-            CAN1_IF2CMSK_R |=0X83;
-            CAN1_IF2DA1_R |= updatePtr->Data;
-            if(updatePtr->bytesNum > 2 )
-            {
-                CAN1_IF2DA2_R |= (updatePtr->Data)>>16;
-            }
-            if(updatePtr->bytesNum > 4 )
-            {
-                CAN1_IF2DB1_R |= (updatePtr->Data)>>16;
-            }
-            if(updatePtr->bytesNum > 6)
+            stdObjects=objects-1u;
+        }
+    }
+    //extended cubes stay behind the standard ids
+    extFirst=stdCount;
+    extCount=can_computeMasks(&can_filterIds[extFirst], extCount, extended, &can_filterCubes[extFirst],
+            objects-stdObjects);
+    stdCount=can_computeMasks(can_filterIds, stdCount, normal, can_filterCubes, stdObjects);
+    for (i=0; i<stdCount+extCount; i++)
+    {
+        receive.messageNum=can_allocObject(module, poolRx);
+        if (receive.messageNum == CAN_NO_OBJECT)
+        {
+            //taken in the meantime: give back this call's objects only
+            while (allocated)
             {
-                CAN1_IF2DB2_R |= (updatePtr->Data)>>16;
+                can_freeObject(module, can_ctz(allocated)+1);
+                allocated &=allocated-1;
             }
-
-            CAN1_IF2CRQ_R |= updatePtr->messageNum; //select the message num in the can ram
-            CAN1_IF2MCTL_R |= 0x0100; //set the TXRQST bit to start transmission
+            return 0;
         }
+        allocated |=1UL<<(receive.messageNum-1);
+    }
+    receive.module=module;
+    receive.bytesNum=8;
+    receive.Data=0;
+    for (i=0, available=allocated; i<stdCount+extCount; i++, available &=available-1)
+    {
+        cube=(i < stdCount) ? &can_filterCubes[i] : &can_filterCubes[extFirst+i-stdCount];
+        receive.ID_type=(i < stdCount) ? normal : extended;
+        receive.ID=cube->ID;
+        receive.ID_mask=cube->mask;
+        receive.messageNum=can_ctz(available)+1;
+        can_configureReceive(&receive);
     }
+    state=CAN_ENTER_CRITICAL();
+    previous=can_filterObjects[module];
+    can_filterObjects[module]=allocated;
+    CAN_EXIT_CRITICAL(state);
+    while (previous)
+    {
+        can_freeObject(module, can_ctz(previous)+1);
+        previous &=previous-1;
+    }
+    return (uint8)(stdCount+extCount);
+}
+/*
+ * Description : Function to get the number of frames accepted by the
+ *               hardware masks of can_filterApply() and dropped by the
+ *               software filter
+ *
+ *  Arguments: module
+ *  Returns: number of dropped frames
+ */
+uint32 can_filterRejected(can_Module module)
+{
+    CAN_PROFILE_FUNCTION(can_filterRejected);
+    return can_filterRejects[module];
 }
 /*
- * Description : Function to configure received data objects
+ * Description : Function to queue a frame for transmission without waiting.
+ *               Frames are handed to the transmit objects in arbitration
+ *               priority order (lowest id first, FIFO for equal ids) as
+ *               objects become free in the TX-complete interrupt. Up to
+ *               CAN_TX_OBJECTS frames already handed to the controller are
+ *               not overtaken by frames queued after them.
  *
  *  Arguments: pointer to structure holding the required info which are:
- *                  can_Interface interface; //CANIF1 or CANIF2
                     can_Module module; //can0 or can1
+                    can_frameType frameType; //DATA OR REMOTE
                     can_IdType ID_type;    //normal or extended
-                    uint32 ID_mask; //mask for acceptance filtering
                     uint32 ID; //ID OF THE MESSAGE
                     uint8 bytesNum; //no of bytes to be sent
                     uint64 Data; //data to be sent
-                    uint8 messageNum; //data object number in the can ram
- *  Returns: void
+ *             ID_mask and messageNum are not used
+ *  Returns: FALSE if the queue of the module is full
  */
-void can_receive(const can_receiveStruct* receivePtr)
+bool can_transmitAsync(const can_transmitStruct* transmitPtr)
 {
-    if (receivePtr->module == 0) //CAN0
+    CAN_PROFILE_FUNCTION(can_transmitAsync);
+    can_frame frame;
+    uint8 i;
+
+    frame.ID=transmitPtr->ID;
+    frame.flags=(transmitPtr->ID_type == extended ? CAN_FRAME_EXTENDED : 0) |
+            (transmitPtr->frameType == remote ? CAN_FRAME_REMOTE : 0);
+    frame.dlc=transmitPtr->bytesNum;
+    frame.messageNum=0;
+    frame.reserved=0;
+    for (i=0; i<8; i++)
     {
-        if(receivePtr->interface == 1) //CANIF1
+        frame.data[i]=(uint8)(transmitPtr->Data>>(8*i));
+    }
+    frame.timestamp=0;
+    return can_sendFrame(transmitPtr->module, &frame);
+}
+/*
+ * Description : Function to queue a frame for transmission without waiting,
+ *               same as can_transmitAsync() for a frame already held in a
+ *               can_frame (e.g. one taken from the receive ring); the
+ *               queue stamps it with the time it was queued
+ *
+ *  Arguments: module, pointer to the frame (ID, flags, dlc and data are used)
+ *  Returns: FALSE if the queue of the module is full
+ */
+bool can_sendFrame(can_Module module, const can_frame* framePtr)
+{
+    CAN_PROFILE_FUNCTION(can_sendFrame);
+    can_txQueue* queue=&can_txQueues[module];
+    bool accepted=FALSE;
+    uint32 state;
 
+    state=CAN_ENTER_CRITICAL();
+    if (queue->count < CAN_TX_QUEUE_SIZE)
+    {
+        can_txPush(queue, framePtr);
+        can_txFeed(module);
+        accepted=TRUE;
+    }
+    CAN_EXIT_CRITICAL(state);
+    return accepted;
+}
+/*
+ * Description : Function to set the function called from can_process()
+ *               for each frame queued by can_transmitAsync() that has been
+ *               sent
+ *
+ *  Arguments: module, callback (0 for none)
+ *  Returns: void
+ */
+void can_setTxCallback(can_Module module, can_txCallback callback)
+{
+    CAN_PROFILE_FUNCTION(can_setTxCallback);
+    can_txQueues[module].callback=callback;
+}
+/*
+ * Description : Function to measure the latency of the frames of an id sent
+ *               through the transmit queue of a module, read with
+ *               can_getTxLatency()
+ *
+ *  Arguments: module, id type, id
+ *  Returns: FALSE if CAN_TX_LATENCY_IDS ids are already tracked
+ */
+bool can_txLatencyTrack(can_Module module, can_IdType ID_type, uint32 ID)
+{
+    CAN_PROFILE_FUNCTION(can_txLatencyTrack);
+    can_txQueue* queue=&can_txQueues[module];
+    uint8 flags=(ID_type == extended) ? CAN_FRAME_EXTENDED : 0;
+    bool tracked=TRUE;
+    uint32 state;
+
+    state=CAN_ENTER_CRITICAL();
+    if (can_txLatencyOf(queue, ID, flags) == 0)
+    {
+        if (queue->latencyIds < CAN_TX_LATENCY_IDS)
         {
-            while(CAN0_IF1CRQ_R & 0x00008000); //wait while can0-if1 is busy
-
-            CAN0_IF1CMSK_R |=0XF3; /* WRNRD=1 to write in the register
-                                          MASK, ARB, CONTROL, DATA A, DATA B=1 to
-                                          to transfer them to the interface registers to be
-                                          able to access them by the cpu */
-            //in order for bits to be used for acceptance filtering we have to enable
-
-            // CAN0_IF1MCTL_R |=0x1000;
-            if(receivePtr->ID_type == 0) // 11 bit id
-            {   /* if we use 11 bit id we have to shift the value by 2 because
-                        the value is stored in bits 2:12 in the following registers */
-                CAN0_IF1MSK2_R |= (receivePtr->ID_mask)<<2; // acceptance filter mask
-                CAN0_IF1ARB2_R  |=(receivePtr->ID)<<2;      // message id
-                CAN0_IF1ARB2_R  |= 0x8000;      //to set direction of transmission and validation bit
-                CAN0_IF1ARB2_R &=~0x4000;       //clear the xtd bit
-
-
-            }
-            else //29 bit id
-            {   /* for 29 bit id, the first register stores the first 16 bit of the id mask or id
-                        and the other register stores the rest so we have to shift the other bits */
-                CAN0_IF1MSK1_R |= (receivePtr->ID_mask);
-                CAN0_IF1MSK2_R |= (receivePtr->ID_mask)>>16;
-                CAN0_IF1ARB1_R  |=(receivePtr->ID);
-                CAN0_IF1ARB2_R  |=(receivePtr->ID)>>16;
-                CAN0_IF1ARB2_R  |= 0xC000; //set the direction, validation, extended frame bit.
-
-            }
-            CAN0_IF1MCTL_R |= 0x3080; // not using fifo,
-            if( CAN0_IF1MCTL_R &0x8000) //If NEWDAT bit is set i.e. there is new data in the data registers
-            { CAN0_IF1MCTL_R |= (receivePtr->bytesNum); //the number of bytes to be transmitted
-            //  while (!( CAN0_IF1MCTL_R & 0x0100); //if no message request
-            CAN0_IF1CRQ_R |= receivePtr->messageNum; //when matching occurs the data is received
-
-            CAN0_IF1DA1_R |= receivePtr->Data;     //first 2 bytes of data
-            CAN0_IF1DA2_R |= (receivePtr->Data)>>16;
-            CAN0_IF1DB1_R |= (receivePtr->Data)>>16;
-            CAN0_IF1DB2_R |= (receivePtr->Data)>>16;
-
-            CAN0_IF1CMSK_R |= 0x04;//Set NEWDAT in CMSK to Clear the NEWDAT bit in MCTL
-
-            }
-            if(CAN0_IF1MCTL_R& 0x4000) //If MSGLST bit is set i.e. there was a message lost
-            {
-                CAN0_IF1MCTL_R &= ~0x4000; //Clear the MSGLST bit
-
-            }
+            memset(&queue->latency[queue->latencyIds], 0, sizeof(can_txLatency));
+            queue->latency[queue->latencyIds].ID=ID;
+            queue->latency[queue->latencyIds].flags=flags;
+            queue->latencyIds++;
         }
-        if(receivePtr->interface == 2)
-
+        else
         {
-            while(CAN0_IF2CRQ_R & 0x00008000); //wait while can0-if1 is busy
-
-            CAN0_IF2CMSK_R |=0XF3; /* WRNRD=1 to write in the register
-                                                      MASK, ARB, CONTROL, DATA A, DATA B=1 to
-                                                      to transfer them to the interface registers to be
-                                                      able to access them by the cpu */
-            //in order for bits to be used for acceptance filtering we have to enable
-
-            // CAN0_IF1MCTL_R |=0x1000;
-            if(receivePtr->ID_type == 0) // 11 bit id
-            {   /* if we use 11 bit id we have to shift the value by 2 because
-                                    the value is stored in bits 2:12 in the following registers */
-                CAN0_IF2MSK2_R |= (receivePtr->ID_mask)<<2; // acceptance filter mask
-                CAN0_IF2ARB2_R  |=(receivePtr->ID)<<2;      // message id
-                CAN0_IF2ARB2_R  |= 0x8000;      //to set direction of transmission and validation bit
-                CAN0_IF2ARB2_R &=~0x4000;       //clear the xtd bit
-
-
-            }
-            else //29 bit id
-            {   /* for 29 bit id, the first register stores the first 16 bit of the id mask or id
-                                    and the other register stores the rest so we have to shift the other bits */
-                CAN0_IF2MSK1_R |= (receivePtr->ID_mask);
-                CAN0_IF2MSK2_R |= (receivePtr->ID_mask)>>16;
-                CAN0_IF2ARB1_R  |=(receivePtr->ID);
-                CAN0_IF2ARB2_R  |=(receivePtr->ID)>>16;
-                CAN0_IF2ARB2_R  |= 0xC000; //set the direction, validation, extended frame bit.
-
-            }
-            CAN0_IF2MCTL_R |= 0x3080; // not using fifo,
-            CAN0_IF2MCTL_R |= (receivePtr->bytesNum); //the number of bytes to be transmitted
-            if ( CAN0_IF2MCTL_R & 0x8000) //if no message request
-            {
-                CAN0_IF2CRQ_R |= receivePtr->messageNum; //when matching occurs the data is received
-                CAN0_IF2DA1_R |= receivePtr->Data;     //first 2 bytes of data
-                CAN0_IF2DA2_R |= (receivePtr->Data)>>16;
-                CAN0_IF2DB1_R |= (receivePtr->Data)>>16;
-                CAN0_IF2DB2_R |= (receivePtr->Data)>>16;
-
-                CAN0_IF2CMSK_R |= 0x04;//Set NEWDAT in CMSK to Clear the NEWDAT bit in MCTL
-
-            }
-            if(CAN0_IF2MCTL_R& 0x4000) //If MSGLST bit is set i.e. there was a message lost
-            {
-                CAN0_IF2MCTL_R &= ~0x4000; //Clear the MSGLST bit
-
-
-            }
-            // CAN0_IF1MCTL_R |= 0x0100; //set the TXRQST bit to start transmission
+            tracked=FALSE;
         }
     }
-    else if (receivePtr->module == 1) //CAN1
-    {
-        if(receivePtr->interface == 1) //CANIF1
-
-        {
-            while(CAN1_IF1CRQ_R & 0x00008000); //wait while can0-if1 is busy
-
-            CAN1_IF1CMSK_R |=0XF3; /* WRNRD=1 to write in the register
-                                              MASK, ARB, CONTROL, DATA A, DATA B=1 to
-                                              to transfer them to the interface registers to be
-                                              able to access them by the cpu */
-            //in order for bits to be used for acceptance filtering we have to enable
-
-            // CAN0_IF1MCTL_R |=0x1000;
-            if(receivePtr->ID_type == 0) // 11 bit id
-            {   /* if we use 11 bit id we have to shift the value by 2 because
-                            the value is stored in bits 2:12 in the following registers */
-                CAN1_IF1MSK2_R |= (receivePtr->ID_mask)<<2; // acceptance filter mask
-                CAN1_IF1ARB2_R  |=(receivePtr->ID)<<2;      // message id
-                CAN1_IF1ARB2_R  |= 0x8000;      //to set direction of transmission and validation bit
-                CAN1_IF1ARB2_R &=~0x4000;       //clear the xtd bit
-
-
-            }
-            else //29 bit id
-            {   /* for 29 bit id, the first register stores the first 16 bit of the id mask or id
-                            and the other register stores the rest so we have to shift the other bits */
-                CAN1_IF1MSK1_R |= (receivePtr->ID_mask);
-                CAN1_IF1MSK2_R |= (receivePtr->ID_mask)>>16;
-                CAN1_IF1ARB1_R  |=(receivePtr->ID);
-                CAN1_IF1ARB2_R  |=(receivePtr->ID)>>16;
-                CAN1_IF1ARB2_R  |= 0xC000; //set the direction, validation, extended frame bit.
-
-            }
-            CAN1_IF1MCTL_R |= 0x3080; // not using fifo,
-            CAN1_IF1MCTL_R |= (receivePtr->bytesNum); //the number of bytes to be transmitted
-            //  while (!( CAN0_IF1MCTL_R & 0x0100); //if no message request
-            CAN1_IF1CRQ_R |= receivePtr->messageNum; //when matching occurs the data is received
-            if ( CAN1_IF1MCTL_R & 0x8000)
-            { CAN1_IF1DA1_R |= receivePtr->Data;     //first 2 bytes of data
-
-            CAN1_IF1DA2_R |= (receivePtr->Data)>>16;
-
-
-            CAN1_IF1DB1_R |= (receivePtr->Data)>>16;
-
-
-            CAN1_IF1DB2_R |= (receivePtr->Data)>>16;
-            CAN1_IF1CMSK_R |= 0x04;//Set NEWDAT in CMSK to Clear the NEWDAT bit in MCTL
-            }
-            if(CAN1_IF1MCTL_R & 0x4000) //If MSGLST bit is set i.e. there was a message lost
-            {
-                CAN1_IF1MCTL_R &= ~0x4000; //Clear the MSGLST bit
-
-
-            }
-            // CAN0_IF1MCTL_R |= 0x0100; //set the TXRQST bit to start transmission
-        }
-        if(receivePtr->interface == 2) //CANIF1
+    CAN_EXIT_CRITICAL(state);
+    return tracked;
+}
+/*
+ * Description : Function to copy the latency histograms of a tracked id,
+ *               the worst queueing and bus delays bound the response time
+ *               of its frames
+ *
+ *  Arguments: module, id type, id, pointer to the structure to fill, TRUE
+ *             to start a new measurement
+ *  Returns: FALSE if the id is not tracked
+ */
+bool can_getTxLatency(can_Module module, can_IdType ID_type, uint32 ID, can_txLatency* latencyPtr, bool reset)
+{
+    CAN_PROFILE_FUNCTION(can_getTxLatency);
+    can_txLatency* latency;
+    uint32 state;
 
+    state=CAN_ENTER_CRITICAL();
+    latency=can_txLatencyOf(&can_txQueues[module], ID, (ID_type == extended) ? CAN_FRAME_EXTENDED : 0);
+    if (latency != 0)
+    {
+        *latencyPtr=*latency;
+        if (reset)
         {
-            while(CAN1_IF2CRQ_R & 0x00008000); //wait while can0-if1 is busy
-
-            CAN1_IF2CMSK_R |=0XF3; /* WRNRD=1 to write in the register
-                                                          MASK, ARB, CONTROL, DATA A, DATA B=1 to
-                                                          to transfer them to the interface registers to be
-                                                          able to access them by the cpu */
-            //in order for bits to be used for acceptance filtering we have to enable
-
-            // CAN0_IF1MCTL_R |=0x1000;
-            if(receivePtr->ID_type == 0) // 11 bit id
-            {   /* if we use 11 bit id we have to shift the value by 2 because
-                                        the value is stored in bits 2:12 in the following registers */
-                CAN1_IF2MSK2_R |= (receivePtr->ID_mask)<<2; // acceptance filter mask
-                CAN1_IF2ARB2_R  |=(receivePtr->ID)<<2;      // message id
-                CAN1_IF2ARB2_R  |= 0x8000;      //to set direction of transmission and validation bit
-                CAN1_IF2ARB2_R &=~0x4000;       //clear the xtd bit
-
-
-            }
-            else //29 bit id
-            {   /* for 29 bit id, the first register stores the first 16 bit of the id mask or id
-                                        and the other register stores the rest so we have to shift the other bits */
-                CAN1_IF2MSK1_R |= (receivePtr->ID_mask);
-                CAN1_IF2MSK2_R |= (receivePtr->ID_mask)>>16;
-                CAN1_IF2ARB1_R  |=(receivePtr->ID);
-                CAN1_IF2ARB2_R  |=(receivePtr->ID)>>16;
-                CAN1_IF2ARB2_R  |= 0xC000; //set the direction, validation, extended frame bit.
-
-            }
-            CAN1_IF2MCTL_R |= 0x3080; // not using fifo,
-            CAN1_IF2MCTL_R |= (receivePtr->bytesNum); //the number of bytes to be received
-            if ( CAN1_IF2MCTL_R & 0x8000) //if no message request
-            {  CAN1_IF2CRQ_R |= receivePtr->messageNum; //when matching occurs the data is received
-            CAN1_IF2DA1_R |= receivePtr->Data;     //first 2 bytes of data
-
-            CAN1_IF2DA2_R |= (receivePtr->Data)>>16;
-
-
-            CAN1_IF2DB1_R |= (receivePtr->Data)>>16;
-
-
-            CAN1_IF2DB2_R |= (receivePtr->Data)>>16;
-
-            CAN1_IF2CMSK_R |= 0x04;//Set NEWDAT in CMSK to Clear the NEWDAT bit in MCTL
-            }
-            if(CAN1_IF2MCTL_R& 0x4000) //If MSGLST bit is set i.e. there was a message lost
-            {
-                CAN1_IF2MCTL_R &= ~0x4000; //Clear the MSGLST bit
-
-
-            }
-
-            // CAN0_IF1MCTL_R |= 0x0100; //set the TXRQST bit to start transmission
+            memset(latency->queueHistogram, 0, sizeof(latency->queueHistogram));
+            memset(latency->busHistogram, 0, sizeof(latency->busHistogram));
+            latency->frames=0;
+            latency->maxQueue=0;
+            latency->maxBus=0;
         }
     }
-
+    CAN_EXIT_CRITICAL(state);
+    return latency != 0;
 }
 /*
- * Description : Function to enable test mode
+ * Description : Function to set the function called from can_process()
+ *               for each status interrupt (TXOK, RXOK, bus error code, change
+ *               of the error warning, error passive or bus-off state)
  *
- *  Arguments: pointer to structure holding the required info which are:
+ *  Arguments: module, callback (0 for none)
+ *  Returns: void
+ */
+void can_setStatusCallback(can_Module module, can_statusCallback callback)
+{
+    CAN_PROFILE_FUNCTION(can_setStatusCallback);
+    can_statusCallbacks[module]=callback;
+}
+/*
+ * Description : Function to get CANSTS as read by the last status interrupt,
+ *               CAN_STS_BOFF, CAN_STS_EPASS and CAN_STS_EWARN give the error
+ *               state of the module
  *
-                    can_Module module; //can0 or can1
-                    can_testingType mode;
+ *  Arguments: module
+ *  Returns: CANSTS value
+ */
+uint32 can_getStatus(can_Module module)
+{
+    CAN_PROFILE_FUNCTION(can_getStatus);
+    return can_status[module];
+}
+/*
+ * Description : Function to choose how a module leaves bus-off. With
+ *               busOffBackoff the wide timer match interrupt (or can_process()
+ *               with another CAN_TIME_US() clock) clears INIT firstDelayUs after
+ *               the bus-off, the wait doubling for each bus-off without a
+ *               frame sent in between up to maxDelayUs; busOffImmediate
+ *               clears it from the ISR; busOffManual leaves it to
+ *               can_busOffRecover(). The controller then waits for 129x11
+ *               recessive bits before the module is back on the bus.
+ *
+ *  Arguments: module, mode, first and longest wait in CAN_TIME_US() units
+ *             (0 for CAN_BUSOFF_FIRST_DELAY / CAN_BUSOFF_MAX_DELAY, at most
+ *             0x7FFFFFFF)
  *  Returns: void
  */
-void can_enableTestMode(const can_testingStruct* testingPtr)
+void can_setBusOffRecovery(can_Module module, can_busOffMode mode, uint32 firstDelayUs, uint32 maxDelayUs)
 {
-    if(testingPtr->module == 0)
+    CAN_PROFILE_FUNCTION(can_setBusOffRecovery);
+    can_busOff* busOff=&can_busOffs[module];
+    uint32 state;
+
+    firstDelayUs=(firstDelayUs != 0) ? firstDelayUs : CAN_BUSOFF_FIRST_DELAY;
+    maxDelayUs=(maxDelayUs != 0) ? maxDelayUs : CAN_BUSOFF_MAX_DELAY;
+    maxDelayUs=(maxDelayUs < 0x7FFFFFFF) ? maxDelayUs : 0x7FFFFFFF;
+    state=CAN_ENTER_CRITICAL();
+    busOff->mode=mode;
+    busOff->firstDelay=(firstDelayUs < maxDelayUs) ? firstDelayUs : maxDelayUs;
+    busOff->maxDelay=maxDelayUs;
+    CAN_EXIT_CRITICAL(state);
+}
+/*
+ * Description : Function to start the recovery of a module waiting in
+ *               bus-off, in any mode: INIT is cleared and the module is back
+ *               on the bus after 129x11 recessive bits
+ *
+ *  Arguments: module
+ *  Returns: FALSE if the module was not waiting in bus-off
+ */
+bool can_busOffRecover(can_Module module)
+{
+    CAN_PROFILE_FUNCTION(can_busOffRecover);
+    can_busOff* busOff=&can_busOffs[module];
+    bool waiting;
+    uint32 state;
+
+    state=CAN_ENTER_CRITICAL();
+    waiting=(busOff->info.state == busOffWaiting);
+    if (waiting)
     {
-        CAN0_CTL_R |= 0X80;
-        if(testingPtr->mode ==0)
-        {
-            CAN0_TST_R |=0X80;
-        }
-        else if (testingPtr->mode ==1)
-        {
-            CAN0_TST_R |=0X20;
-        }
-        else if (testingPtr->mode ==2)
-        {
-            CAN0_TST_R |=0X60;
-        }
-        else if (testingPtr->mode ==2)
-        {
-            CAN0_TST_R |=0X40;
-        }
+        CAN_REGS(module)->CTL &=~CAN_CTL_INIT;
+        busOff->info.state=busOffRecovering;
     }
-    else if(testingPtr->module == 1)
+    CAN_EXIT_CRITICAL(state);
+    return waiting;
+}
+/*
+ * Description : Function to read the bus-off state and history of a module,
+ *               lastRecoveryUs/maxRecoveryUs measure the time from the
+ *               bus-off interrupt to the one reporting BOFF cleared
+ *
+ *  Arguments: module, pointer to the structure to fill
+ *  Returns: void
+ */
+void can_getBusOffInfo(can_Module module, can_busOffInfo* infoPtr)
+{
+    CAN_PROFILE_FUNCTION(can_getBusOffInfo);
+    uint32 state;
+
+    state=CAN_ENTER_CRITICAL();
+    *infoPtr=can_busOffs[module].info;
+    CAN_EXIT_CRITICAL(state);
+}
+#if defined(CAN_RX_WTIMER) && !defined(CAN_HOST_SIM)
+/*
+ * Description : wide timer match at the end of a bus-off back-off: the
+ *               modules whose wait is over leave bus-off, the match is set
+ *               again for a module still waiting. WTIMER0A_Handler() unless
+ *               CAN_TIMESTAMP_TIMER selects another timer.
+ */
+void CAN_WTIMER_HANDLER(void)
+{
+    CAN_PROFILE_FUNCTION(CAN_WTIMER_HANDLER);
+    uint8 module;
+
+    CAN_WTIMER(ICR) =TIMER_ICR_TAMCINT;
+    for (module=0; module<2; module++)
     {
-        CAN1_CTL_R |= 0X80;
-        if(testingPtr->mode ==0)
-        {
-            CAN1_TST_R |=0X80;
-        }
-        else if (testingPtr->mode ==1)
-        {
-            CAN1_TST_R |=0X20;
-        }
-        else if (testingPtr->mode ==2)
-        {
-            CAN1_TST_R |=0X60;
-        }
-        else if (testingPtr->mode ==2)
+        if (can_busOffDue(&can_busOffs[module]))
         {
-            CAN1_TST_R |=0X40;
+            can_busOffRecover((can_Module)module);
         }
     }
+    can_busOffWake();
 }
+#endif
 /*
- * Description : Function to enable silent mode
+ * Description : Function to get the number of frames not yet sent,
+ *               including the ones already in transmit objects
  *
- *  Arguments: pointer to enum holding the required info which are:
+ *  Arguments: module
+ *  Returns: number of frames
+ */
+uint32 can_txQueued(can_Module module)
+{
+    CAN_PROFILE_FUNCTION(can_txQueued);
+    can_txQueue* queue=&can_txQueues[module];
+    uint32 busy, count, state;
+
+    state=CAN_ENTER_CRITICAL();
+    busy=queue->busyObjects;
+    count=queue->count;
+    CAN_EXIT_CRITICAL(state);
+    while (busy)
+    {
+        busy &=busy-1;
+        count++;
+    }
+    return count;
+}
+/*
+ * Description : Function to allocate a free message object of a pool, to be
+ *               used as messageNum of the transmit/receive structures.
+ *               Transmit objects are taken lowest first (a lower object is
+ *               sent first among pending ones), receive and fifo objects
+ *               highest first, each with one bit scan of the pool bitmap.
  *
-                    can_Module module; //can0 or can1
-
- *  Returns: void
+ *  Arguments: module, pool
+ *  Returns: message object number, CAN_NO_OBJECT if the pool is full or pool
+ *           is not a can_objectPool
  */
-void can_enableSilentMode(const can_Module* module)
+can_objectHandle can_allocObject(can_Module module, can_objectPool pool)
 {
-    if(module ==0)
-    {    CAN0_CTL_R |= 0X80;
-        CAN0_TST_R |=0X08;
+    CAN_PROFILE_FUNCTION(can_allocObject);
+    can_objectHandle handle=CAN_NO_OBJECT;
+    uint32 state, available;
+
+    if ((uint32)pool > poolFifo)
+    {
+        return CAN_NO_OBJECT;
     }
-    else
-    {    CAN1_CTL_R |= 0X80;
-        CAN1_TST_R |=0X08;
+    state=CAN_ENTER_CRITICAL();
+    available=can_poolMask[pool] & ~can_objectsInUse[module];
+    if (available)
+    {
+        handle=(pool == poolTx ? can_ctz(available) : can_msb(available)) + 1;
+        can_objectsInUse[module] |=1UL<<(handle-1);
     }
+    CAN_EXIT_CRITICAL(state);
+    return handle;
 }
 /*
- * Description : Function to enable loopback mode
+ * Description : Function to give back a message object, it is invalidated
+ *               (MSGVAL cleared) before it can be allocated again. Members
+ *               of a fifo are only given back all together with
+ *               can_freeRxFifo().
  *
- *  Arguments: pointer to enum holding the required info which are:
- *
-                    can_Module module; //can0 or can1
-
+ *  Arguments: module, object returned by can_allocObject()
  *  Returns: void
  */
-void can_enableLoopBackMode(const can_Module* module)
+void can_freeObject(can_Module module, can_objectHandle handle)
 {
-    if(module ==0)
+    CAN_PROFILE_FUNCTION(can_freeObject);
+    uint32 state, bit;
+
+    if (handle < 1 || handle > 32)
     {
-        CAN0_CTL_R |= 0X80;
-        CAN0_TST_R |=0X10;
+        return;
     }
-    else
+    bit=1UL<<(handle-1);
+    if ((bit & (CAN_TX_OBJECT_MASK | can_fifoObjects[module])) || !(can_objectsInUse[module] & bit))
     {
-        CAN1_CTL_R |= 0X80;
-        CAN1_TST_R |=0X10;
+        return;
     }
+    state=CAN_ENTER_CRITICAL();
+    can_invalidateObject(module, handle);
+    can_objectsInUse[module] &=~bit;
+    CAN_EXIT_CRITICAL(state);
 }
+/*
+ * Description : Function to give back the objects of a fifo made by
+ *               can_configureRxFifo(), every member is invalidated and its
+ *               fifo bits are cleared
+ *
+ *  Arguments: module, any member of the fifo (normally the object returned
+ *             by can_configureRxFifo())
+ *  Returns: FALSE if the object is not in a fifo or an interface stayed
+ *           busy, the fifo is then kept and can be freed again
+ */
+bool can_freeRxFifo(can_Module module, can_objectHandle handle)
+{
+    CAN_PROFILE_FUNCTION(can_freeRxFifo);
+    uint32 state, members, left;
+    bool freed=TRUE;
 
+    if (handle < 1 || handle > 32 || !(can_fifoObjects[module] & 1UL<<(handle-1)))
+    {
+        return FALSE;
+    }
+    state=CAN_ENTER_CRITICAL();
+    members=can_fifoMembers(module, handle);
+    for (left=members; left && freed; left &=left-1)
+    {
+        freed=can_invalidateObject(module, can_ctz(left)+1);
+    }
+    if (freed)
+    {
+        can_fifoObjects[module] &=~members;
+        can_fifoEnds[module] &=~members;
+        can_objectsInUse[module] &=~members;
+    }
+    CAN_EXIT_CRITICAL(state);
+    return freed && members != 0;
+}
+/*
+ * Description : Function to get the allocation bitmap of a module
+ *
+ *  Arguments: module
+ *  Returns: bit n-1 set while message object n is allocated or reserved
+ */
+uint32 can_usedObjects(can_Module module)
+{
+    CAN_PROFILE_FUNCTION(can_usedObjects);
+    return can_objectsInUse[module];
+}
+/*
+ * Description : CAN0 interrupt handler, to be placed in the vector table
+ */
+void CAN0_Handler(void)
+{
+    CAN_PROFILE_FUNCTION(CAN0_Handler);
+    can_serviceInterrupt(module0);
+}
+/*
+ * Description : CAN1 interrupt handler, to be placed in the vector table
+ */
+void CAN1_Handler(void)
+{
+    CAN_PROFILE_FUNCTION(CAN1_Handler);
+    can_serviceInterrupt(module1);
+}
@@ -8,40 +8,289 @@
 #ifndef CAN_H_
 #define CAN_H_
 #include <stdlib.h>
-#include <math.h>
 #include <stdint.h>
 #include "tm4c123gh6pm.h"
 #include "std_types.h"
+#include "can_regs.h"
+#ifdef CAN_HOST_SIM
+#include "can_sim.h" //register macros redirected to the host model
+#endif
+/*******************************************************************************
+ *                         Definitions                                         *
+ *******************************************************************************/
+#ifndef CAN_RX_RING_SIZE
+#define CAN_RX_RING_SIZE    64  //frames buffered per module, must be a power of 2
+#endif
+#if (CAN_RX_RING_SIZE & (CAN_RX_RING_SIZE-1)) != 0
+#error "CAN_RX_RING_SIZE must be a power of 2"
+#endif
+//wide timer (WTIMERn, 0..5) of the default time stamps and of the bus-off
+//back-off on the target, together with its WTIMERnA_Handler()
+#ifndef CAN_TIMESTAMP_TIMER
+#define CAN_TIMESTAMP_TIMER 0
+#endif
+#if CAN_TIMESTAMP_TIMER < 0 || CAN_TIMESTAMP_TIMER > 5
+#error "CAN_TIMESTAMP_TIMER must be 0..5"
+#endif
+#define CAN_WTIMER_NAME(n, reg)     WTIMER##n##_##reg##_R
+#define CAN_WTIMER_REG(n, reg)      CAN_WTIMER_NAME(n, reg)
+#define CAN_WTIMER(reg)             CAN_WTIMER_REG(CAN_TIMESTAMP_TIMER, reg)
+#define CAN_WTIMER_ISR_NAME(n)      WTIMER##n##A_Handler
+#define CAN_WTIMER_ISR(n)           CAN_WTIMER_ISR_NAME(n)
+#define CAN_WTIMER_HANDLER          CAN_WTIMER_ISR(CAN_TIMESTAMP_TIMER)
+#define CAN_WTIMER_INT              (INT_WTIMER0A+2*CAN_TIMESTAMP_TIMER) //vector, timer A
+//time stamp taken by the ISR for every received frame: the CAN_TIMESTAMP_TIMER
+//wide timer chained to 64 bits counting the system clock up, started by
+//can_init(), or nanoseconds of bus time on the host model
+#ifndef CAN_RX_TIMESTAMP
+#ifdef CAN_HOST_SIM
+#define CAN_RX_TIMESTAMP()  can_sim_getTimeNs()
+#else
+#define CAN_RX_TIMESTAMP()  can_wideTimer()
+#define CAN_RX_WTIMER       1
+#endif
+#endif
+//1 stamps every frame of an ISR invocation with the time of its entry, 0 with
+//the time its message object is read
+#ifndef CAN_RX_TIMESTAMP_AT_ENTRY
+#define CAN_RX_TIMESTAMP_AT_ENTRY   0
+#endif
+//CAN_RX_TIMESTAMP() ticks subtracted from the stamps for the delay between
+//the end of a frame and the ISR (exception entry, interrupts of higher
+//priority), 0 for no correction
+#ifndef CAN_RX_LATENCY
+#define CAN_RX_LATENCY      0
+#endif
+#ifndef CAN_TX_QUEUE_SIZE
+#define CAN_TX_QUEUE_SIZE   32  //frames waiting for a transmit object per module
+#endif
+//sent frames and status values kept per module by the ISR until can_process()
+//passes them to the callbacks
+#ifndef CAN_EVENT_RING_SIZE
+#define CAN_EVENT_RING_SIZE 16  //must be a power of 2
+#endif
+#if (CAN_EVENT_RING_SIZE & (CAN_EVENT_RING_SIZE-1)) != 0
+#error "CAN_EVENT_RING_SIZE must be a power of 2"
+#endif
+//message objects owned by can_transmitAsync(), not to be used by other calls
+#ifndef CAN_TX_FIRST_OBJECT
+#define CAN_TX_FIRST_OBJECT 1
+#endif
+#ifndef CAN_TX_OBJECTS
+#define CAN_TX_OBJECTS      4
+#endif
+#if CAN_TX_OBJECTS < 1 || CAN_TX_FIRST_OBJECT < 1 || CAN_TX_FIRST_OBJECT+CAN_TX_OBJECTS > 33
+#error "transmit objects must be inside message objects 1..32"
+#endif
+//bit n-1 set for message objects first..first+count-1
+#define CAN_OBJECT_RANGE(first, count)  ((((1ULL<<(count))-1) << ((first)-1)) & 0xFFFFFFFFULL)
+//message objects handed out by can_allocObject(), one range per can_objectPool
+#ifndef CAN_POOL_TX_FIRST
+#define CAN_POOL_TX_FIRST       5
+#define CAN_POOL_TX_OBJECTS     4
+#endif
+#ifndef CAN_POOL_FIFO_FIRST
+#define CAN_POOL_FIFO_FIRST     9
+#define CAN_POOL_FIFO_OBJECTS   16
+#endif
+#ifndef CAN_POOL_RX_FIRST
+#define CAN_POOL_RX_FIRST       25
+#define CAN_POOL_RX_OBJECTS     8
+#endif
+#if (CAN_OBJECT_RANGE(CAN_TX_FIRST_OBJECT, CAN_TX_OBJECTS) & CAN_OBJECT_RANGE(CAN_POOL_TX_FIRST, CAN_POOL_TX_OBJECTS)) || \
+    (CAN_OBJECT_RANGE(CAN_TX_FIRST_OBJECT, CAN_TX_OBJECTS) & CAN_OBJECT_RANGE(CAN_POOL_FIFO_FIRST, CAN_POOL_FIFO_OBJECTS)) || \
+    (CAN_OBJECT_RANGE(CAN_TX_FIRST_OBJECT, CAN_TX_OBJECTS) & CAN_OBJECT_RANGE(CAN_POOL_RX_FIRST, CAN_POOL_RX_OBJECTS)) || \
+    (CAN_OBJECT_RANGE(CAN_POOL_TX_FIRST, CAN_POOL_TX_OBJECTS) & CAN_OBJECT_RANGE(CAN_POOL_FIFO_FIRST, CAN_POOL_FIFO_OBJECTS)) || \
+    (CAN_OBJECT_RANGE(CAN_POOL_TX_FIRST, CAN_POOL_TX_OBJECTS) & CAN_OBJECT_RANGE(CAN_POOL_RX_FIRST, CAN_POOL_RX_OBJECTS)) || \
+    (CAN_OBJECT_RANGE(CAN_POOL_FIFO_FIRST, CAN_POOL_FIFO_OBJECTS) & CAN_OBJECT_RANGE(CAN_POOL_RX_FIRST, CAN_POOL_RX_OBJECTS))
+#error "message object pools must not overlap each other or the transmit queue objects"
+#endif
+#if CAN_POOL_TX_FIRST+CAN_POOL_TX_OBJECTS > 33 || CAN_POOL_FIFO_FIRST+CAN_POOL_FIFO_OBJECTS > 33 || \
+    CAN_POOL_RX_FIRST+CAN_POOL_RX_OBJECTS > 33
+#error "message object pools must be inside message objects 1..32"
+#endif
+#define CAN_NO_OBJECT   0   //can_allocObject() found no free object
+//different functions can_registerHandler() keeps, at most 255
+#ifndef CAN_HANDLERS
+#define CAN_HANDLERS            32
+#endif
+#if CAN_HANDLERS < 1 || CAN_HANDLERS > 255
+#error "CAN_HANDLERS must be 1..255"
+#endif
+//exact extended ids and masked extended filters with a handler
+#ifndef CAN_EXT_HANDLER_IDS
+#define CAN_EXT_HANDLER_IDS     64
+#endif
+#ifndef CAN_EXT_HANDLER_MASKS
+#define CAN_EXT_HANDLER_MASKS   8
+#endif
+//ids the software filter of a module holds, standard and extended together
+#ifndef CAN_FILTER_IDS
+#define CAN_FILTER_IDS          128
+#endif
+//most ids can_computeMasks() takes, its merging costs the cube of the count
+#ifndef CAN_MASK_IDS
+#define CAN_MASK_IDS            CAN_FILTER_IDS
+#endif
+#if CAN_MASK_IDS < CAN_FILTER_IDS
+#error "CAN_MASK_IDS must hold the CAN_FILTER_IDS ids of can_filterApply()"
+#endif
+//slots of the extended id hash of a module, a power of 2 above CAN_FILTER_IDS
+#ifndef CAN_FILTER_EXT_SLOTS
+#define CAN_FILTER_EXT_SLOTS    256
+#endif
+#if (CAN_FILTER_EXT_SLOTS & (CAN_FILTER_EXT_SLOTS-1)) != 0 || CAN_FILTER_EXT_SLOTS <= CAN_FILTER_IDS
+#error "CAN_FILTER_EXT_SLOTS must be a power of 2 above CAN_FILTER_IDS"
+#endif
+//message objects serviced by one invocation of the ISR, the interrupt stays
+//pending for the rest
+#ifndef CAN_ISR_OBJECT_BUDGET
+#define CAN_ISR_OBJECT_BUDGET   32
+#endif
+//ids of the transmit queue whose latency is measured per module, and log2
+//buckets of their histograms
+#ifndef CAN_TX_LATENCY_IDS
+#define CAN_TX_LATENCY_IDS      8
+#endif
+#ifndef CAN_TX_LATENCY_BUCKETS
+#define CAN_TX_LATENCY_BUCKETS  24
+#endif
+//how the ISR wakes the deferred worker (can_process()) after filling a ring:
+//0 main loop polls, 1 PendSV is set pending, 2 interrupt CAN_DEFER_IRQ is
+//triggered through NVIC_SW_TRIG (a free vector with a low priority)
+#ifndef CAN_DEFER_MODE
+#define CAN_DEFER_MODE          0
+#endif
+#if CAN_DEFER_MODE == 1
+#define CAN_DEFER_SIGNAL()      (NVIC_INT_CTRL_R =NVIC_INT_CTRL_PEND_SV)
+#elif CAN_DEFER_MODE == 2
+#ifndef CAN_DEFER_IRQ
+#error "CAN_DEFER_MODE 2 needs the interrupt number CAN_DEFER_IRQ"
+#endif
+#define CAN_DEFER_SIGNAL()      (NVIC_SW_TRIG_R =(CAN_DEFER_IRQ))
+#else
+#define CAN_DEFER_SIGNAL()
+#endif
+#ifndef CAN_HOST_SIM
+//DWT cycle counter of the Cortex-M4, started by can_init()
+#define CAN_DWT_CTRL_R          (*((volatile uint32_t *)0xE0001000))
+#define CAN_DWT_CYCCNT_R        (*((volatile uint32_t *)0xE0001004))
+#endif
+//clock of the ISR duration of can_getIsrLoad(): the free running 32 bit DWT
+//cycle counter on the target (unlike SysTick it does not depend on a reload
+//value), nanoseconds of a monotonic clock on the host model. A clock of
+//fewer bits is defined with its CAN_ISR_CLOCK_MASK.
+#ifndef CAN_ISR_CLOCK
+#ifdef CAN_HOST_SIM
+#define CAN_ISR_CLOCK()         can_sim_monotonicNs()
+#else
+#define CAN_ISR_CLOCK()         CAN_DWT_CYCCNT_R
+#endif
+#endif
+#ifndef CAN_ISR_CLOCK_MASK
+#define CAN_ISR_CLOCK_MASK      0xFFFFFFFF
+#endif
+//microsecond clock of the bus-off back-off and recovery times: the wide timer
+//at the system clock given to can_init() on the target, bus time on the host
+//model. Without a clock busOffBackoff leaves bus-off at once like
+//busOffImmediate.
+#ifndef CAN_TIME_US
+#ifdef CAN_HOST_SIM
+#define CAN_TIME_US()           ((uint32)(can_sim_getTimeNs()/1000))
+#elif defined(CAN_RX_WTIMER)
+#define CAN_TIME_US()           can_timerToUs(can_wideTimer())
+#endif
+#endif
+//first wait before leaving bus-off, doubled on each bus-off without a frame
+//sent in between up to CAN_BUSOFF_MAX_DELAY (microseconds)
+#ifndef CAN_BUSOFF_FIRST_DELAY
+#define CAN_BUSOFF_FIRST_DELAY  10000
+#endif
+#ifndef CAN_BUSOFF_MAX_DELAY
+#define CAN_BUSOFF_MAX_DELAY    1000000
+#endif
+//polls of the BUSY bit before an interface is considered stuck
+#ifndef CAN_IF_BUSY_TIMEOUT
+#define CAN_IF_BUSY_TIMEOUT 1000
+#endif
+//bit timings kept by can_computeBitTiming(), the best one first
+#ifndef CAN_BIT_TIMING_CANDIDATES
+#define CAN_BIT_TIMING_CANDIDATES   4
+#endif
+#define CAN_FRAME_EXTENDED  0x01 //can_frame.flags, 29 bit id
+#define CAN_FRAME_REMOTE    0x02 //remote frame (RTR), dlc is the length requested
+#define CAN_FRAME_LOST      0x04 //a frame was overwritten in the message object before this one
+#if defined(__GNUC__) || defined(__clang__) || defined(__TI_ARM__)
+#define CAN_ALIGNED(n)      __attribute__((aligned(n)))
+#else
+#define CAN_ALIGNED(n)
+#endif
+#define CAN_SAMPLE_POINT_DEFAULT    875 //per mille of the bit time
+//1 adds can_computeBitTiming() and the clockCustom path of can_init(), the
+//only float arithmetic of the driver (delays); with 0 can_init() only accepts
+//the clocks and bit rates of its table
+#ifndef CAN_BIT_TIMING_SOLVER
+#define CAN_BIT_TIMING_SOLVER       0
+#endif
+//1 counts the cycles of every public function and of the ISR with the DWT
+//cycle counter (nanoseconds of a monotonic clock on the host model), read
+//with can_getProfile(); 0 leaves no trace of the measurement in the code
+#ifndef CAN_PROFILE
+#define CAN_PROFILE                 0
+#endif
+#if CAN_PROFILE
+#if !defined(__GNUC__) && !defined(__clang__)
+#error "CAN_PROFILE needs the cleanup attribute of GCC or clang"
+#endif
+#ifndef CAN_PROFILE_BUCKETS
+#define CAN_PROFILE_BUCKETS         16
+#endif
+#ifdef CAN_HOST_SIM
+#define CAN_CYCLES()                can_sim_monotonicNs()
+#else
+#define CAN_CYCLES()                CAN_DWT_CYCCNT_R
+#endif
+#endif
 /*******************************************************************************
  *                         Types Declaration                                   *
  *******************************************************************************/
-//assume we use CANIF1 for transmission and CANIF2 for receiving
+//IF1 and IF2 are owned by the driver, which uses them in turn
 typedef enum {
     module0, module1
 }can_Module;
-typedef enum {
-    interface1=1, interface2=2
-}can_Interface;
 typedef enum {
     normal, extended
 }can_IdType;
 typedef enum {
     data, remote
 }can_frameType;
+//ranges of message objects given by can_allocObject()
+typedef enum {
+    poolTx, poolRx, poolFifo
+}can_objectPool;
+typedef uint8 can_objectHandle; //message object number 1..32, used as messageNum
 typedef enum
 {
  receive,bitTiming, physicalHigh, physicalLow
 }can_testingType;
+//clocks and bit rates with precomputed CANBIT/CANBRPE values
+typedef enum {
+    clockCustom, clock16MHz, clock40MHz, clock50MHz, clock80MHz
+}can_clock;
+typedef enum {
+    bitRate125k, bitRate250k, bitRate500k, bitRate1M
+}can_bitRateSelect;
 typedef struct {
     can_Module module;
     uint64 bitRate; //bit time needs to be an integer multiple of the can clk
-    uint8 n;    //needs to be between 4 and 25
+    uint8 n;    //needs to be between 4 and 25, 0 to let can_init choose
     uint64 Fsys;
     float32 delays;
+    can_clock clock; //clockCustom computes the timing from the fields above
+    can_bitRateSelect rate; //used when clock is not clockCustom
 
 }can_configStruct;
 typedef struct {
-    can_Interface interface; //CANIF1 or CANIF2
     can_Module module; //can0 or can1
     can_frameType frameType; //DATA OR REMOTE
     can_IdType ID_type;    //normal or extended
@@ -52,14 +301,12 @@ typedef struct {
     uint8 messageNum; //data object number in the can ram
 }can_transmitStruct;
 typedef struct{
-    can_Interface interface;
     can_Module module; //can0 or can1
-    uint8 bytesNum;//bytes that need to be updated
+    uint8 bytesNum;//bytes 0..bytesNum-1 of Data are written, the others keep their value
     uint64 Data;
     uint8 messageNum;
 }can_updateStruct;
 typedef struct{
-    can_Interface interface;
     can_Module module; //can0 or can1
     can_IdType ID_type;    //normal or extended
     uint32 ID_mask; //mask for acceptance filtering
@@ -69,25 +316,445 @@ typedef struct{
     uint8 messageNum; //data object number in the can ram
 
 }can_receiveStruct;
+/*
+ * Frame shared by the receive ring, the transmit queue and the callbacks,
+ * 32 bytes on a 16 byte boundary.
+ * data[0] is the first byte on the bus.
+ */
+typedef struct CAN_ALIGNED(16) {
+    uint32 ID; //11 or 29 bit id
+    uint8 flags; //CAN_FRAME_EXTENDED, CAN_FRAME_REMOTE, CAN_FRAME_LOST
+    uint8 dlc; //0..8
+    uint8 messageNum; //message object the frame was read from or sent with
+    uint8 reserved;
+    uint8 data[8];
+    uint64 timestamp; //CAN_RX_TIMESTAMP() at ISR entry or object read, less CAN_RX_LATENCY
+}can_frame;
+typedef char can_frameSizeCheck[(sizeof(can_frame) == 32) ? 1 : -1];
+//acceptance filter of a message object, set bits of mask must match
+typedef struct {
+    uint32 ID;
+    uint32 mask;
+}can_idMask;
+//called by can_dispatch() for a received frame with an id it was registered for
+typedef void (*can_rxHandler)(can_Module module, const can_frame* framePtr);
+//cost of the ISR of a module since start up or the last reset
+typedef struct {
+    uint32 invocations;
+    uint32 maxObjects; //most message objects read by one invocation
+    uint32 maxTicks; //longest invocation in CAN_ISR_CLOCK() ticks
+    uint32 budgetExhausted; //invocations that left objects pending
+}can_isrLoad;
+//transmit latency of one id of the transmit queue in CAN_RX_TIMESTAMP() ticks:
+//queue from can_sendFrame() to TXRQST, bus from TXRQST to the completion
+//interrupt (lost arbitrations, retransmissions and the frame itself). Bucket k
+//counts delays of 2^k..2^(k+1)-1 ticks, 0 is in bucket 0 and the last bucket
+//takes everything above.
+typedef struct {
+    uint32 ID;
+    uint8 flags; //CAN_FRAME_EXTENDED
+    uint32 frames;
+    uint32 maxQueue;
+    uint32 maxBus;
+    uint32 queueHistogram[CAN_TX_LATENCY_BUCKETS];
+    uint32 busHistogram[CAN_TX_LATENCY_BUCKETS];
+}can_txLatency;
+//bus health counters of a module since start up or the last reset, one
+//aligned block (64 bytes on the target) written by the ISR and copied whole
+//by can_getStats()
+typedef struct CAN_ALIGNED(32) {
+    uint32 txFrames; //frames of the transmit queue sent
+    uint32 rxFrames; //frames received, not counting those rejected by the software filter
+    uint32 txOk; //status interrupts with TXOK
+    uint32 rxOk; //status interrupts with RXOK
+    uint32 lec[8]; //status interrupts per CANSTS.LEC, indexed by CAN_STS_LEC_STUFF..CAN_STS_LEC_CRC
+    uint32 errorWarning; //transitions into the error warning state
+    uint32 errorPassive; //transitions into the error passive state
+    uint32 busOff; //transitions into bus-off
+    uint8 peakTec; //highest CANERR counters read by a status interrupt
+    uint8 peakRec;
+    uint16 reserved;
+}can_stats;
+typedef char can_statsSizeCheck[(sizeof(can_stats) % 32 == 0) ? 1 : -1];
+//how a module leaves bus-off: INIT cleared after a growing wait in
+//can_process(), at once by the ISR, or by can_busOffRecover()
+typedef enum {
+    busOffBackoff, busOffImmediate, busOffManual
+}can_busOffMode;
+typedef enum {
+    busOn, busOffWaiting, busOffRecovering
+}can_busState;
+typedef struct {
+    can_busState state; //busOffRecovering: INIT cleared, 129x11 recessive bits awaited
+    uint32 count; //bus-off events since start up
+    uint32 consecutive; //bus-off events without a frame sent in between
+    uint8 lastTec; //CANERR counters read on the last bus-off
+    uint8 lastRec;
+    uint32 lastRecoveryUs; //from the last bus-off to bus on, CAN_TIME_US() units
+    uint32 maxRecoveryUs;
+}can_busOffInfo;
+//called from can_process() with the CANSTS value read on each status interrupt
+typedef void (*can_statusCallback)(can_Module module, uint32 status);
+//called from can_process() once a frame queued by can_transmitAsync() was sent,
+//the timestamp of the frame is then its completion time
+typedef void (*can_txCallback)(can_Module module, const can_frame* framePtr);
 typedef struct
 {
      can_Module module; //can0 or can1
      can_testingType mode;
 
 }can_testingStruct;
+typedef struct {
+    uint32 Fsys; //clock of the can module in Hz
+    uint32 bitRate; //bits per second
+    uint32 propDelay; //round trip delay of bus and transceivers in ns
+    uint16 samplePoint; //wanted sample point per mille, 0 for CAN_SAMPLE_POINT_DEFAULT
+    uint8 quanta; //time quanta per bit (4..25), 0 to search all
+}can_bitTimingRequest;
+typedef struct {
+    uint16 prescaler; //1..1024, CANBIT.BRP extended by CANBRPE
+    uint8 quanta; //time quanta per bit, 4..25
+    uint8 propSeg; //quanta covering propDelay
+    uint8 phaseSeg1;
+    uint8 phaseSeg2;
+    uint8 sjw;
+    uint16 samplePoint; //per mille of the bit time
+    uint32 bitRate; //obtained bit rate
+    uint32 tolerance; //oscillator tolerance the setting allows, ppm
+    uint32 BIT; //value for CANBIT
+    uint32 BRPE; //value for CANBRPE
+}can_bitTiming;
+typedef struct {
+    can_bitTiming timing[CAN_BIT_TIMING_CANDIDATES]; //best setting first
+    uint8 count;
+}can_bitTimingResult;
+#if CAN_PROFILE
+//cost of a function in CAN_CYCLES() units since its first call or the last
+//can_profileReset(), bucket k of the histogram counts the calls of
+//2^k..2^(k+1)-1 cycles and the last bucket takes everything above
+typedef struct can_profileStruct {
+    const char* name;
+    uint32 calls;
+    uint32 minCycles;
+    uint32 maxCycles;
+    uint64 totalCycles; //mean is totalCycles/calls
+    uint64 exclusiveCycles; //totalCycles less the measured functions and ISRs nested in it
+    uint32 histogram[CAN_PROFILE_BUCKETS];
+    struct can_profileStruct* next; //functions called so far, linked by can_profileExit()
+}can_profile;
+typedef struct can_profileScopeStruct {
+    can_profile* profilePtr;
+    struct can_profileScopeStruct* parentPtr; //measured function this one runs in
+    uint32 nestedCycles; //cycles of the measured functions called from this one
+    uint32 start;
+}can_profileScope;
+#endif
 
 /*******************************************************************************
  *                      Functions Prototypes                                   *
  *******************************************************************************/
 bool can_init(const can_configStruct* configPtr);
-void can_transmit(const can_transmitStruct* transmitPtr);
-void can_updateMessage(const can_updateStruct* updatePtr);
+#if CAN_BIT_TIMING_SOLVER
+bool can_computeBitTiming(const can_bitTimingRequest* requestPtr, can_bitTimingResult* resultPtr);
+#endif
+bool can_setBitTiming(can_Module module, uint32 bitValue, uint32 brpeValue);
+void can_getBitTiming(can_Module module, can_bitTiming* timingPtr);
+bool can_transmit(const can_transmitStruct* transmitPtr);
+uint32 can_transmitBatch(const can_transmitStruct* frames, uint32 count);
+bool can_updateMessage(const can_updateStruct* updatePtr);
 void can_receive(const can_receiveStruct* receivePtr);
-void can_enableTestMode(const can_testingStruct* testingPtr);
+bool can_enableTestMode(const can_testingStruct* testingPtr);
 void can_enableSilentMode(const can_Module* module);
 void can_enableLoopBackMode(const can_Module* module);
+void can_configureReceive(const can_receiveStruct* receivePtr);
+can_objectHandle can_configureRxFifo(const can_receiveStruct* receivePtr, uint8 depth);
+bool can_readFrame(can_Module module, can_frame* framePtr);
+const can_frame* can_peekFrame(can_Module module);
+void can_releaseFrame(can_Module module);
+uint32 can_rxPending(can_Module module);
+uint32 can_rxOverflows(can_Module module);
+uint32 can_eventOverflows(can_Module module);
+bool can_registerHandler(can_IdType ID_type, uint32 ID, uint32 ID_mask, can_rxHandler handler);
+uint32 can_dispatch(can_Module module, uint32 maxFrames);
+uint32 can_process(uint32 maxFrames);
+void can_getIsrLoad(can_Module module, can_isrLoad* loadPtr, bool reset);
+void can_getStats(can_Module module, can_stats* statsPtr, bool reset);
+bool can_filterAdd(can_Module module, can_IdType ID_type, uint32 ID);
+uint8 can_filterApply(can_Module module, uint8 objects);
+uint32 can_filterRejected(can_Module module);
+uint32 can_computeMasks(const uint32* ids, uint32 count, can_IdType ID_type, can_idMask* cubes, uint32 maxMasks);
+uint32 can_falseAccepts(const uint32* ids, uint32 count, can_IdType ID_type, const can_idMask* cubes,
+                        uint32 cubeCount);
+bool can_transmitAsync(const can_transmitStruct* transmitPtr);
+bool can_sendFrame(can_Module module, const can_frame* framePtr);
+void can_setTxCallback(can_Module module, can_txCallback callback);
+bool can_txLatencyTrack(can_Module module, can_IdType ID_type, uint32 ID);
+bool can_getTxLatency(can_Module module, can_IdType ID_type, uint32 ID, can_txLatency* latencyPtr, bool reset);
+void can_setStatusCallback(can_Module module, can_statusCallback callback);
+uint32 can_getStatus(can_Module module);
+void can_setBusOffRecovery(can_Module module, can_busOffMode mode, uint32 firstDelayUs, uint32 maxDelayUs);
+bool can_busOffRecover(can_Module module);
+void can_getBusOffInfo(can_Module module, can_busOffInfo* infoPtr);
+can_objectHandle can_allocObject(can_Module module, can_objectPool pool);
+void can_freeObject(can_Module module, can_objectHandle handle);
+bool can_freeRxFifo(can_Module module, can_objectHandle handle);
+uint32 can_usedObjects(can_Module module);
+uint32 can_txQueued(can_Module module);
+void CAN0_Handler(void);
+void CAN1_Handler(void);
+#if defined(CAN_RX_WTIMER) && !defined(CAN_HOST_SIM)
+void CAN_WTIMER_HANDLER(void); //WTIMER0A_Handler() by default
+#endif
+#if CAN_PROFILE
+can_profileScope* can_profileEnter(can_profileScope* scopePtr);
+void can_profileExit(const can_profileScope* scopePtr);
+void can_profileReset(void);
+bool can_getProfile(uint32 index, can_profile* profilePtr);
+#endif
+
+
+/*******************************************************************************
+ *                      Inline Functions                                       *
+ *******************************************************************************/
+//interrupt masking around data and interfaces shared with the ISR
+#if defined(CAN_HOST_SIM)
+#define CAN_ENTER_CRITICAL()    can_sim_enterCritical()
+#define CAN_EXIT_CRITICAL(s)    can_sim_exitCritical(s)
+#elif defined(__TI_ARM__)
+#define CAN_ENTER_CRITICAL()    _disable_IRQ()
+#define CAN_EXIT_CRITICAL(s)    _restore_interrupts(s)
+#else
+#define CAN_ENTER_CRITICAL()    can_disableIrq()
+#define CAN_EXIT_CRITICAL(s)    can_restoreIrq(s)
+static inline uint32 can_disableIrq(void)
+{
+    uint32 primask;
+    __asm__ volatile ("mrs %0, primask\n\tcpsid i" : "=r" (primask) :: "memory");
+    return primask;
+}
+static inline void can_restoreIrq(uint32 primask)
+{
+    __asm__ volatile ("msr primask, %0" :: "r" (primask) : "memory");
+}
+#endif
+#ifdef CAN_RX_WTIMER
+/*
+ * Description : reads the 64 bit count of the wide timer, the high half is
+ *               read again to catch a carry out of the low half
+ */
+static inline uint64 can_wideTimer(void)
+{
+    uint32 high, low;
 
+    do
+    {
+        high=CAN_WTIMER(TBV);
+        low=CAN_WTIMER(TAV);
+    } while (high != CAN_WTIMER(TBV));
+    return (uint64)high<<32 | low;
+}
+#endif
+/*
+ * Description : waits for the command transfer of an interface to finish,
+ *               at most CAN_IF_BUSY_TIMEOUT polls
+ *
+ *  Returns: FALSE if BUSY did not clear
+ */
+static inline bool can_waitInterface(const can_ifRegs* ifRegs)
+{
+    uint32 polls;
+
+    for (polls=0; polls<CAN_IF_BUSY_TIMEOUT; polls++)
+    {
+        if (!(ifRegs->CRQ & CAN_IF1CRQ_BUSY))
+        {
+            return TRUE;
+        }
+    }
+    return FALSE;
+}
+/*
+ * Description : loads the data registers of an interface from a byte array,
+ *               the first byte goes to the low byte of DA1
+ */
+static inline void can_packData(can_ifRegs* ifRegs, const uint8* data)
+{
+    ifRegs->DA1 =data[0] | (uint32)data[1]<<8;
+    ifRegs->DA2 =data[2] | (uint32)data[3]<<8;
+    ifRegs->DB1 =data[4] | (uint32)data[5]<<8;
+    ifRegs->DB2 =data[6] | (uint32)data[7]<<8;
+}
+/*
+ * Description : copies the data registers of an interface into a byte array
+ */
+static inline void can_unpackData(const can_ifRegs* ifRegs, uint8* data)
+{
+    uint32 da1=ifRegs->DA1, da2=ifRegs->DA2, db1=ifRegs->DB1, db2=ifRegs->DB2;
+
+    data[0]=(uint8)da1;
+    data[1]=(uint8)(da1>>8);
+    data[2]=(uint8)da2;
+    data[3]=(uint8)(da2>>8);
+    data[4]=(uint8)db1;
+    data[5]=(uint8)(db1>>8);
+    data[6]=(uint8)db2;
+    data[7]=(uint8)(db2>>8);
+}
+/*
+ * Description : programs a transmit object through one interface and
+ *               requests its transmission in the same command transfer
+ *
+ *  Returns: FALSE if the interface stayed busy, nothing is written then
+ */
+static inline bool can_writeTransmit(can_ifRegs* ifRegs, const can_transmitStruct* transmitPtr)
+{
+    uint32 msk1, msk2, arb1, arb2;
 
+    if (transmitPtr->ID_type == normal) // 11 bit id in bits 2:12
+    {
+        msk1=0;
+        msk2=(transmitPtr->ID_mask & 0x7FF)<<2;
+        arb1=0;
+        arb2=CAN_IF1ARB2_MSGVAL | CAN_IF1ARB2_DIR | ((transmitPtr->ID & 0x7FF)<<2);
+    }
+    else //29 bit id
+    {
+        msk1=transmitPtr->ID_mask & 0xFFFF;
+        msk2=(transmitPtr->ID_mask>>16) & 0x1FFF;
+        arb1=transmitPtr->ID & 0xFFFF;
+        arb2=CAN_IF1ARB2_MSGVAL | CAN_IF1ARB2_XTD | CAN_IF1ARB2_DIR | ((transmitPtr->ID>>16) & 0x1FFF);
+    }
+    if (!can_waitInterface(ifRegs))
+    {
+        return FALSE;
+    }
+    ifRegs->CMSK =CAN_IF1CMSK_WRNRD | CAN_IF1CMSK_MASK | CAN_IF1CMSK_ARB | CAN_IF1CMSK_CONTROL |
+            CAN_IF1CMSK_TXRQST | CAN_IF1CMSK_DATAA | CAN_IF1CMSK_DATAB;
+    ifRegs->MSK1 =msk1;
+    ifRegs->MSK2 =msk2;
+    ifRegs->ARB1 =arb1;
+    ifRegs->ARB2 =arb2;
+    //a remote frame type answers received remote frames automatically
+    ifRegs->MCTL =CAN_IF1MCTL_UMASK | CAN_IF1MCTL_EOB | (transmitPtr->frameType == remote ? CAN_IF1MCTL_RMTEN : 0) |
+            (transmitPtr->bytesNum & CAN_IF1MCTL_DLC_M);
+    ifRegs->DA1 =transmitPtr->Data & 0xFFFF;
+    ifRegs->DA2 =(transmitPtr->Data>>16) & 0xFFFF;
+    ifRegs->DB1 =(transmitPtr->Data>>32) & 0xFFFF;
+    ifRegs->DB2 =(transmitPtr->Data>>48) & 0xFFFF;
+    ifRegs->CRQ =transmitPtr->messageNum;
+    CAN_HW_SYNC(ifRegs);
+    return TRUE;
+}
+/*
+ * Description : replaces the first bytesNum data bytes of a transmit object
+ *               and requests its transmission in the same command transfer.
+ *               Only the halves holding them (DATAA for bytes 0-3, DATAB for
+ *               bytes 4-7) are transferred, always with both of their
+ *               registers; when bytesNum ends inside a half, the half is
+ *               read from the object first so its other bytes are written
+ *               back unchanged. MASK/ARB/CONTROL are left untouched.
+ *
+ *  Returns: FALSE if the interface stayed busy, nothing is written then
+ */
+static inline bool can_writeUpdate(can_ifRegs* ifRegs, const can_updateStruct* updatePtr)
+{
+    uint8 bytes=updatePtr->bytesNum > 8 ? 8 : updatePtr->bytesNum;
+    uint32 halves=0;
+    uint64 data=updatePtr->Data, kept, written;
 
+    if (bytes > 0)
+    {
+        halves |=CAN_IF1CMSK_DATAA;
+    }
+    if (bytes > 4)
+    {
+        halves |=CAN_IF1CMSK_DATAB;
+    }
+    if (!can_waitInterface(ifRegs))
+    {
+        return FALSE;
+    }
+    if (bytes & 3)
+    {
+        ifRegs->CMSK =halves; //read direction, NEWDAT and INTPND untouched
+        ifRegs->CRQ =updatePtr->messageNum;
+        CAN_HW_SYNC(ifRegs);
+        if (!can_waitInterface(ifRegs))
+        {
+            return FALSE;
+        }
+        kept=(ifRegs->DA1 & 0xFFFF) | (uint64)(ifRegs->DA2 & 0xFFFF)<<16 |
+                (uint64)(ifRegs->DB1 & 0xFFFF)<<32 | (uint64)(ifRegs->DB2 & 0xFFFF)<<48;
+        written=(1ULL<<(8*bytes))-1;
+        data=(data & written) | (kept & ~written);
+    }
+    if (halves & CAN_IF1CMSK_DATAA)
+    {
+        ifRegs->DA1 =data & 0xFFFF;
+        ifRegs->DA2 =(data>>16) & 0xFFFF;
+    }
+    if (halves & CAN_IF1CMSK_DATAB)
+    {
+        ifRegs->DB1 =(data>>32) & 0xFFFF;
+        ifRegs->DB2 =(data>>48) & 0xFFFF;
+    }
+    ifRegs->CMSK =CAN_IF1CMSK_WRNRD | CAN_IF1CMSK_TXRQST | halves;
+    ifRegs->CRQ =updatePtr->messageNum;
+    CAN_HW_SYNC(ifRegs);
+    return TRUE;
+}
+/*
+ * CAN_PROFILE_FUNCTION(function) opens a function measured with CAN_PROFILE:
+ * the counter is read where it stands and again by can_profileExit() when the
+ * scope variable goes out of scope, so every return of the function is
+ * covered. can_profileEnter() links the scope under the one of the calling
+ * function, which gets the cycles back as nested. It expands to nothing
+ * without CAN_PROFILE.
+ */
+#if CAN_PROFILE
+#define CAN_PROFILE_FUNCTION(function)  CAN_PROFILE_NAMED(function) //name macros expanded
+#define CAN_PROFILE_NAMED(function)                                                 \
+    static can_profile can_profileData={#function, 0, 0, 0, 0, 0, {0}, 0};          \
+    can_profileScope can_profileScopeData __attribute__((cleanup(can_profileExit)))= \
+            {&can_profileData, can_profileEnter(&can_profileScopeData), 0, CAN_CYCLES()}
+#else
+#define CAN_PROFILE_FUNCTION(function)
+#endif
+/*******************************************************************************
+ *                      Compile-time Instances                                 *
+ *******************************************************************************/
+/*
+ * CAN_DEFINE_INSTANCE(MODULE) defines inline functions bound to one module,
+ * e.g. CAN_DEFINE_INSTANCE(CAN0) gives
+ *      can_transmit_CAN0(const can_transmitStruct* transmitPtr)
+ *      can_updateMessage_CAN0(const can_updateStruct* updatePtr)
+ * each measured with CAN_PROFILE like the functions of can.c (one profile
+ * per source file the instance is defined in).
+ * The base address is a constant so every call is a straight register
+ * sequence through IF1 without module branches; the module field of the
+ * structures is not read. Interrupts are masked while IF1 is programmed,
+ * as the ISR may use it too. can_transmit_MODULE() and
+ * can_updateMessage_MODULE() return FALSE when IF1 stayed busy for
+ * CAN_IF_BUSY_TIMEOUT polls.
+ */
+#define CAN_INSTANCE_MODULE_CAN0    module0
+#define CAN_INSTANCE_MODULE_CAN1    module1
+#define CAN_DEFINE_INSTANCE(MODULE)                                                 \
+static inline bool can_transmit_##MODULE(const can_transmitStruct* transmitPtr)     \
+{                                                                                   \
+    CAN_PROFILE_FUNCTION(can_transmit_##MODULE);                                    \
+    uint32 state=CAN_ENTER_CRITICAL();                                              \
+    bool written=can_writeTransmit(&CAN_REGS(CAN_INSTANCE_MODULE_##MODULE)->IF[0], transmitPtr); \
+    CAN_EXIT_CRITICAL(state);                                                       \
+    return written;                                                                 \
+}                                                                                   \
+static inline bool can_updateMessage_##MODULE(const can_updateStruct* updatePtr)    \
+{                                                                                   \
+    CAN_PROFILE_FUNCTION(can_updateMessage_##MODULE);                               \
+    uint32 state=CAN_ENTER_CRITICAL();                                              \
+    bool written=can_writeUpdate(&CAN_REGS(CAN_INSTANCE_MODULE_##MODULE)->IF[0], updatePtr); \
+    CAN_EXIT_CRITICAL(state);                                                       \
+    return written;                                                                 \
+}
 
 #endif /* CAN_H_ */
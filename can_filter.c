@@ -0,0 +1,285 @@
+/*
+ * File name: can_filter.c
+ *
+ *  Hardware acceptance masks covering a set of ids with few message objects
+ */
+#include "can.h"
+/*******************************************************************************
+ *                      Private Functions                                      *
+ *******************************************************************************/
+static uint8 can_popCount(uint32 value)
+{
+#if defined(__GNUC__) || defined(__clang__)
+    return (uint8)__builtin_popcount((unsigned int)value);
+#else
+    uint8 count=0;
+    while (value)
+    {
+        value &=value-1;
+        count++;
+    }
+    return count;
+#endif
+}
+/*
+ * Description : number of ids a cube accepts, 2 to the power of its free bits
+ */
+static uint32 can_cubeSize(uint32 mask, uint8 width)
+{
+    return 1UL<<(width-can_popCount(mask));
+}
+/*
+ * Description : smallest cube holding two cubes, the bits fixed in both with
+ *               the same value stay fixed
+ */
+static void can_cubeMerge(const can_idMask* a, const can_idMask* b, can_idMask* mergedPtr)
+{
+    mergedPtr->mask=a->mask & b->mask & ~(a->ID ^ b->ID);
+    mergedPtr->ID=a->ID & mergedPtr->mask;
+}
+static bool can_cubeInside(const can_idMask* inner, const can_idMask* outer)
+{
+    return (inner->mask & outer->mask) == outer->mask && ((inner->ID ^ outer->ID) & outer->mask) == 0;
+}
+static bool can_cubeHolds(const can_idMask* cube, uint32 ID)
+{
+    return ((ID ^ cube->ID) & cube->mask) == 0;
+}
+/*
+ * Description : first cube accepting an id, the one whose object receives it
+ */
+static uint32 can_cubeOf(const can_idMask* cubes, uint32 count, uint32 ID)
+{
+    uint32 k;
+
+    for (k=0; k<count && !can_cubeHolds(&cubes[k], ID); k++);
+    return k;
+}
+/*
+ * Description : smallest cube holding the ids of the set that go to cube k
+ *               (and have bit set to value when bit is not 0)
+ *
+ *  Returns: number of those ids, the cube is not written when it is 0
+ */
+static uint32 can_cubeTight(const uint32* ids, uint32 count, const can_idMask* cubes, uint32 cubeCount,
+                            uint32 k, uint32 full, uint32 bit, uint32 value, can_idMask* tightPtr)
+{
+    uint32 i, first=0, differ=0, inside=0;
+
+    for (i=0; i<count; i++)
+    {
+        if ((ids[i] & bit) != value || can_cubeOf(cubes, cubeCount, ids[i] & full) != k)
+        {
+            continue;
+        }
+        if (inside++ == 0)
+        {
+            first=ids[i] & full;
+        }
+        differ |=(ids[i] & full) ^ first;
+    }
+    if (inside != 0)
+    {
+        tightPtr->mask=full & ~differ;
+        tightPtr->ID=first & tightPtr->mask;
+    }
+    return inside;
+}
+/*
+ * Description : greedy merging of cubes down to maxMasks: the pair whose
+ *               merged cube is the least larger than the two is merged, cubes
+ *               inside the result are dropped
+ */
+static uint32 can_mergeCubes(can_idMask* cubes, uint32 count, uint8 width, uint32 maxMasks)
+{
+    uint32 i, j, k, bestI=0, bestJ=0;
+    sint64 cost, bestCost;
+    can_idMask merged;
+
+    while (count > maxMasks)
+    {
+        bestCost=0x7FFFFFFFFFFFFFFFLL;
+        for (i=0; i<count; i++)
+        {
+            for (j=i+1; j<count; j++)
+            {
+                can_cubeMerge(&cubes[i], &cubes[j], &merged);
+                cost=(sint64)can_cubeSize(merged.mask, width) - can_cubeSize(cubes[i].mask, width) -
+                        can_cubeSize(cubes[j].mask, width);
+                if (cost < bestCost)
+                {
+                    bestCost=cost;
+                    bestI=i;
+                    bestJ=j;
+                }
+            }
+        }
+        can_cubeMerge(&cubes[bestI], &cubes[bestJ], &merged);
+        cubes[bestI]=merged;
+        //drop the cubes the merged one holds, including the other half
+        for (i=0, k=0; i<count; i++)
+        {
+            if (i == bestI || !can_cubeInside(&cubes[i], &merged))
+            {
+                cubes[k++]=cubes[i];
+            }
+        }
+        count=k;
+    }
+    return count;
+}
+/*
+ * Description : shrinks every cube to the ids it receives, cubes receiving
+ *               none are dropped
+ */
+static uint32 can_shrinkCubes(const uint32* ids, uint32 count, can_idMask* cubes, uint32 cubeCount, uint32 full)
+{
+    can_idMask tight;
+    uint32 k=0;
+
+    while (k < cubeCount)
+    {
+        if (can_cubeTight(ids, count, cubes, cubeCount, k, full, 0, 0, &tight) != 0)
+        {
+            cubes[k++]=tight;
+        }
+        else
+        {
+            cubes[k]=cubes[--cubeCount];
+        }
+    }
+    return cubeCount;
+}
+/*
+ * Description : splits the cube with the most false accepts in two along the
+ *               free bit leaving the fewest, while objects are left
+ */
+static uint32 can_splitCubes(const uint32* ids, uint32 count, can_idMask* cubes, uint32 cubeCount,
+                             uint8 width, uint32 full, uint32 maxMasks)
+{
+    can_idMask low, high, bestLow, bestHigh;
+    uint32 k, worst, inside, lowCount, highCount, bit, falseAccepts, worstFalse, bestFalse;
+
+    while (cubeCount < maxMasks)
+    {
+        worst=cubeCount;
+        worstFalse=0;
+        for (k=0; k<cubeCount; k++)
+        {
+            inside=can_cubeTight(ids, count, cubes, cubeCount, k, full, 0, 0, &low);
+            falseAccepts=can_cubeSize(cubes[k].mask, width)-inside;
+            if (falseAccepts > worstFalse)
+            {
+                worstFalse=falseAccepts;
+                worst=k;
+            }
+        }
+        if (worst == cubeCount)
+        {
+            return cubeCount; //every cube is exact
+        }
+        //a split removing nothing still lets the halves be split further
+        bestFalse=worstFalse+1;
+        for (bit=1; bit & full; bit<<=1)
+        {
+            if (cubes[worst].mask & bit)
+            {
+                continue;
+            }
+            lowCount=can_cubeTight(ids, count, cubes, cubeCount, worst, full, bit, 0, &low);
+            highCount=can_cubeTight(ids, count, cubes, cubeCount, worst, full, bit, bit, &high);
+            if (lowCount == 0 || highCount == 0)
+            {
+                continue;
+            }
+            falseAccepts=can_cubeSize(low.mask, width)-lowCount + can_cubeSize(high.mask, width)-highCount;
+            if (falseAccepts < bestFalse)
+            {
+                bestFalse=falseAccepts;
+                bestLow=low;
+                bestHigh=high;
+            }
+        }
+        if (bestFalse > worstFalse)
+        {
+            return cubeCount;
+        }
+        cubes[worst]=bestLow;
+        cubes[cubeCount++]=bestHigh;
+    }
+    return cubeCount;
+}
+/*******************************************************************************
+ *                      Functions Definitions                                  *
+ *******************************************************************************/
+/*
+ * Description : Function to cover a set of ids with at most maxMasks id/mask
+ *  pairs for the acceptance filters of the message objects, accepting as few
+ *  ids outside the set as it can:
+ *  1. every id starts as a cube with all bits fixed, while there are too many
+ *     cubes the pair whose merged cube adds the fewest ids is merged and the
+ *     cubes inside the result are dropped
+ *  2. each cube is shrunk to the smallest cube of the ids it receives
+ *  3. while objects are left the cube with the most false accepts is split
+ *     in two along the free bit that removes the most of them
+ *  Each merge compares every pair of cubes, so the cost grows with the cube
+ *  of the number of ids: count is limited to CAN_MASK_IDS, run it at start up
+ *  or offline with can_maskgen.
+ *
+ *  Arguments: distinct ids, number of ids, id type (11 or 29 bits), array of count
+ *             cubes used as work area and filled with the result, maximum
+ *             number of cubes
+ *  Returns: number of cubes at the start of the array, 0 if count or
+ *           maxMasks is 0 or count is above CAN_MASK_IDS
+ */
+uint32 can_computeMasks(const uint32* ids, uint32 count, can_IdType ID_type, can_idMask* cubes, uint32 maxMasks)
+{
+    CAN_PROFILE_FUNCTION(can_computeMasks);
+    uint8 width=(ID_type == normal) ? 11 : 29;
+    uint32 full=(ID_type == normal) ? 0x7FF : 0x1FFFFFFF;
+    uint32 i, cubeCount;
+
+    if (count == 0 || count > CAN_MASK_IDS || maxMasks == 0)
+    {
+        return 0;
+    }
+    for (i=0; i<count; i++)
+    {
+        cubes[i].ID=ids[i] & full;
+        cubes[i].mask=full;
+    }
+    cubeCount=can_mergeCubes(cubes, count, width, maxMasks);
+    cubeCount=can_shrinkCubes(ids, count, cubes, cubeCount, full);
+    return can_splitCubes(ids, count, cubes, cubeCount, width, full, maxMasks);
+}
+/*
+ * Description : Function to count the ids accepted by a set of cubes without
+ *  being in the list, an id accepted by several cubes is counted once per
+ *  cube. Used to compare settings of can_computeMasks(), ids must be
+ *  distinct.
+ *
+ *  Arguments: ids, number of ids, id type, cubes, number of cubes
+ *  Returns: number of falsely accepted ids
+ */
+uint32 can_falseAccepts(const uint32* ids, uint32 count, can_IdType ID_type, const can_idMask* cubes,
+                        uint32 cubeCount)
+{
+    CAN_PROFILE_FUNCTION(can_falseAccepts);
+    uint8 width=(ID_type == normal) ? 11 : 29;
+    uint32 full=(ID_type == normal) ? 0x7FF : 0x1FFFFFFF;
+    uint32 i, k, inside, total=0;
+
+    for (k=0; k<cubeCount; k++)
+    {
+        inside=0;
+        for (i=0; i<count; i++)
+        {
+            if (can_cubeHolds(&cubes[k], ids[i] & full))
+            {
+                inside++;
+            }
+        }
+        total +=can_cubeSize(cubes[k].mask & full, width)-inside;
+    }
+    return total;
+}
@@ -0,0 +1,87 @@
+/*
+ * File name: can_maskgen.c
+ *
+ *  Host tool printing the receive objects that cover a list of ids, for
+ *  tables built offline instead of calling can_filterApply() at start up:
+ *
+ *      gcc can_maskgen.c can_filter.c -o can_maskgen
+ *      can_maskgen [-x] objects < ids.txt
+ *
+ *  It takes up to CAN_MASK_IDS ids, -DCAN_MASK_IDS=n raises the limit at the
+ *  price of a run time growing with the cube of the count.
+ *
+ *  ids are read as hexadecimal numbers separated by white space, -x takes
+ *  them as 29 bit extended ids. The output is an array of can_idMask and the
+ *  number of ids the masks accept beyond the list, for the software filter.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "can.h"
+/*******************************************************************************
+ *                         Global Variables                                    *
+ *******************************************************************************/
+static uint32 maskgen_ids[CAN_MASK_IDS];
+static can_idMask maskgen_cubes[CAN_MASK_IDS];
+/*******************************************************************************
+ *                      Functions Definitions                                  *
+ *******************************************************************************/
+int main(int argc, char** argv)
+{
+    can_IdType type=normal;
+    uint32 full=0x7FF, count=0, objects, cubeCount, i, j;
+    unsigned long value;
+    bool repeated;
+    int arg=1;
+
+    if (arg < argc && strcmp(argv[arg], "-x") == 0)
+    {
+        type=extended;
+        full=0x1FFFFFFF;
+        arg++;
+    }
+    if (arg+1 != argc || (objects=strtoul(argv[arg], 0, 0)) < 1 || objects > 32)
+    {
+        fprintf(stderr, "usage: can_maskgen [-x] objects(1..32) < ids\n");
+        return 1;
+    }
+    while (scanf("%lx", &value) == 1)
+    {
+        if ((value & ~(unsigned long)full) != 0)
+        {
+            fprintf(stderr, "id 0x%lX does not fit the id type\n", value);
+            return 1;
+        }
+        for (j=0, repeated=FALSE; j<count && !repeated; j++)
+        {
+            repeated=(maskgen_ids[j] == value);
+        }
+        if (repeated)
+        {
+            continue;
+        }
+        if (count == CAN_MASK_IDS)
+        {
+            fprintf(stderr, "more than %d ids\n", CAN_MASK_IDS);
+            return 1;
+        }
+        maskgen_ids[count++]=(uint32)value;
+    }
+    if (count == 0)
+    {
+        fprintf(stderr, "no ids\n");
+        return 1;
+    }
+    cubeCount=can_computeMasks(maskgen_ids, count, type, maskgen_cubes, objects);
+    printf("/* %lu %s ids, %lu objects, %lu ids accepted beyond the list */\n", (unsigned long)count,
+            type == normal ? "standard" : "extended", (unsigned long)cubeCount,
+            (unsigned long)can_falseAccepts(maskgen_ids, count, type, maskgen_cubes, cubeCount));
+    printf("static const can_idMask can_rxMasks[%lu] = {\n", (unsigned long)cubeCount);
+    for (i=0; i<cubeCount; i++)
+    {
+        printf("    {0x%0*lX, 0x%0*lX},\n", type == normal ? 3 : 8, (unsigned long)maskgen_cubes[i].ID,
+                type == normal ? 3 : 8, (unsigned long)maskgen_cubes[i].mask);
+    }
+    printf("};\n");
+    return 0;
+}
@@ -0,0 +1,130 @@
+/*
+ * File name: can_profile.c
+ *
+ *  Cycle counts of the driver functions and the ISR, built with CAN_PROFILE=1
+ */
+#include <string.h>
+#include "can.h"
+#if CAN_PROFILE
+/*******************************************************************************
+ *                         Global Variables                                    *
+ *******************************************************************************/
+//ends the list, a profile whose next is 0 is not linked yet
+static can_profile can_profileEnd;
+static can_profile* can_profiles=&can_profileEnd; //last called function first
+static can_profileScope* can_profileCurrent; //innermost measured function running
+/*******************************************************************************
+ *                      Functions Definitions                                  *
+ *******************************************************************************/
+/*
+ * Description : Function called on the entry of a function opened with
+ *  CAN_PROFILE_FUNCTION(), makes its scope the innermost one. An ISR entered
+ *  in between links its scope and takes it out again before returning.
+ *
+ *  Arguments: scope variable of the entered function
+ *  Returns: scope of the measured function it is called from, 0 if none
+ */
+can_profileScope* can_profileEnter(can_profileScope* scopePtr)
+{
+    can_profileScope* parentPtr=can_profileCurrent;
+
+    can_profileCurrent=scopePtr;
+    return parentPtr;
+}
+/*
+ * Description : Function called on the return of a function opened with
+ *  CAN_PROFILE_FUNCTION(), adds its cycles to the profile of the function.
+ *  Calls nested in a measured function (ISRs included) are counted in the
+ *  total cycles of both and in the exclusive cycles of the nested one only.
+ *
+ *  Arguments: scope variable of the returning function
+ *  Returns: void
+ */
+void can_profileExit(const can_profileScope* scopePtr)
+{
+    uint32 cycles=(CAN_CYCLES()-scopePtr->start) & 0xFFFFFFFF;
+    can_profile* profilePtr=scopePtr->profilePtr;
+    uint8 bucket=0;
+    uint32 state;
+
+    if (cycles != 0)
+    {
+        for (bucket=0; bucket < CAN_PROFILE_BUCKETS-1 && cycles>>(bucket+1) != 0; bucket++);
+    }
+    state=CAN_ENTER_CRITICAL();
+    can_profileCurrent=scopePtr->parentPtr;
+    if (scopePtr->parentPtr != 0)
+    {
+        scopePtr->parentPtr->nestedCycles +=cycles;
+    }
+    if (profilePtr->next == 0)
+    {
+        profilePtr->next=can_profiles;
+        can_profiles=profilePtr;
+    }
+    if (profilePtr->calls == 0 || cycles < profilePtr->minCycles)
+    {
+        profilePtr->minCycles=cycles;
+    }
+    if (cycles > profilePtr->maxCycles)
+    {
+        profilePtr->maxCycles=cycles;
+    }
+    profilePtr->calls++;
+    profilePtr->totalCycles +=cycles;
+    //the nested cycles were read later than start, they cannot exceed cycles
+    profilePtr->exclusiveCycles +=cycles-scopePtr->nestedCycles;
+    profilePtr->histogram[bucket]++;
+    CAN_EXIT_CRITICAL(state);
+}
+/*
+ * Description : Function to start the cycle counter and clear the profiles,
+ *  called at start up before the functions to be measured (on the target
+ *  the DWT counter only runs once it has been enabled here)
+ *
+ *  Arguments: void
+ *  Returns: void
+ */
+void can_profileReset(void)
+{
+    can_profile* profilePtr;
+    uint32 state;
+
+#ifndef CAN_HOST_SIM
+    NVIC_DBG_INT_R |=0x01000000; //DEMCR.TRCENA powers the DWT
+    CAN_DWT_CTRL_R |=0x00000001; //CYCCNTENA
+#endif
+    state=CAN_ENTER_CRITICAL();
+    for (profilePtr=can_profiles; profilePtr != &can_profileEnd; profilePtr=profilePtr->next)
+    {
+        profilePtr->calls=0;
+        profilePtr->minCycles=0;
+        profilePtr->maxCycles=0;
+        profilePtr->totalCycles=0;
+        profilePtr->exclusiveCycles=0;
+        memset(profilePtr->histogram, 0, sizeof(profilePtr->histogram));
+    }
+    CAN_EXIT_CRITICAL(state);
+}
+/*
+ * Description : Function to copy the profile of one of the functions called
+ *  so far, index 0 being the last one called for the first time
+ *
+ *  Arguments: index, pointer to the structure to fill
+ *  Returns: FALSE if index is past the last profile
+ */
+bool can_getProfile(uint32 index, can_profile* profilePtr)
+{
+    can_profile* entry;
+    uint32 state;
+
+    state=CAN_ENTER_CRITICAL();
+    for (entry=can_profiles; entry != &can_profileEnd && index > 0; entry=entry->next, index--);
+    if (entry != &can_profileEnd)
+    {
+        *profilePtr=*entry;
+    }
+    CAN_EXIT_CRITICAL(state);
+    return entry != &can_profileEnd;
+}
+#endif
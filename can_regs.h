@@ -0,0 +1,77 @@
+/*
+ * File name: can_regs.h
+ *
+ *  Register map of one CAN module laid over its base address, so a single
+ *  code path reaches CAN0/CAN1 and IF1/IF2 by indexing instead of using the
+ *  four sets of CANx_IFn register names of tm4c123gh6pm.h.
+ *  Both interfaces have the same layout, their bit fields are used with the
+ *  CAN_IF1xxx names of tm4c123gh6pm.h.
+ */
+
+#ifndef CAN_REGS_H_
+#define CAN_REGS_H_
+#include <stdint.h>
+#include "tm4c123gh6pm.h"
+#include "std_types.h"
+/*******************************************************************************
+ *                         Types Declaration                                   *
+ *******************************************************************************/
+typedef struct {
+    volatile uint32_t CRQ;      //command request, message number and BUSY
+    volatile uint32_t CMSK;     //command mask
+    volatile uint32_t MSK1;
+    volatile uint32_t MSK2;
+    volatile uint32_t ARB1;
+    volatile uint32_t ARB2;
+    volatile uint32_t MCTL;
+    volatile uint32_t DA1;
+    volatile uint32_t DA2;
+    volatile uint32_t DB1;
+    volatile uint32_t DB2;
+    volatile uint32_t reserved[13];
+}can_ifRegs;
+typedef struct {
+    volatile uint32_t CTL;      //0x000
+    volatile uint32_t STS;
+    volatile uint32_t ERR;
+    volatile uint32_t BIT;
+    volatile uint32_t INT;
+    volatile uint32_t TST;
+    volatile uint32_t BRPE;
+    volatile uint32_t reserved0;
+    can_ifRegs IF[2];           //0x020 IF1, 0x080 IF2
+    volatile uint32_t reserved1[8];
+    volatile uint32_t TXRQ[2];  //0x100
+    volatile uint32_t reserved2[6];
+    volatile uint32_t NWDA[2];  //0x120
+    volatile uint32_t reserved3[6];
+    volatile uint32_t MSGINT[2];//0x140
+    volatile uint32_t reserved4[6];
+    volatile uint32_t MSGVAL[2];//0x160
+}can_Regs;
+//the layout must match the peripheral, CANMSG2VAL ends at offset 0x168
+typedef char can_regsLayoutCheck[(sizeof(can_Regs) == 0x168) ? 1 : -1];
+/*******************************************************************************
+ *                         Definitions                                         *
+ *******************************************************************************/
+#define CAN0_BASE           0x40040000
+#define CAN_MODULE_STRIDE   0x1000
+
+/*
+ * CAN_REGS(module) gives the register block of module 0 or 1, a constant
+ * module folds to a constant address.
+ * CAN_HW_SYNC(regs) follows every write of CRQ and CAN_HW_STATUS_READ(regs)
+ * every read of STS; they are empty on the target and let the host model
+ * execute the command transfer or clear the status interrupt.
+ */
+#ifdef CAN_HOST_SIM
+#define CAN_REGS(module)            ((can_Regs*)can_sim_regs(module))
+#define CAN_HW_SYNC(regs)           can_sim_sync(regs)
+#define CAN_HW_STATUS_READ(regs)    can_sim_statusRead(regs)
+#else
+#define CAN_REGS(module)            ((can_Regs*)(CAN0_BASE + (uint32_t)(module)*CAN_MODULE_STRIDE))
+#define CAN_HW_SYNC(regs)
+#define CAN_HW_STATUS_READ(regs)
+#endif
+
+#endif /* CAN_REGS_H_ */
@@ -0,0 +1,983 @@
+/*
+ * File name: can_sim.c
+ *
+ *  Host-side register level model of the CAN0/CAN1 peripherals, see can_sim.h
+ */
+#ifndef _POSIX_C_SOURCE
+#define _POSIX_C_SOURCE 199309L //clock_gettime()
+#endif
+#include <string.h>
+#include <time.h>
+#include "can_sim.h"
+/*******************************************************************************
+ *                         Definitions                                         *
+ *******************************************************************************/
+#define CAN0_BASE_ADDRESS   0x40040000
+#define CAN1_BASE_ADDRESS   0x40041000
+#define CAN_MODULE_SPAN     0x1000
+#define SIM_REG_WORDS       (0x168/4)   //CANCTL up to CANMSG2VAL
+#define SIM_PLAIN_REGS      32          //non CAN registers (SYSCTL, GPIO, ...)
+
+//word index of the registers inside a module
+#define SIM_CTL     (0x000/4)
+#define SIM_STS     (0x004/4)
+#define SIM_ERR     (0x008/4)
+#define SIM_BIT     (0x00C/4)
+#define SIM_INT     (0x010/4)
+#define SIM_TST     (0x014/4)
+#define SIM_BRPE    (0x018/4)
+#define SIM_IF1     (0x020/4)
+#define SIM_IF2     (0x080/4)
+#define SIM_TXRQ1   (0x100/4)
+#define SIM_NWDA1   (0x120/4)
+#define SIM_MSG1INT (0x140/4)
+#define SIM_MSG1VAL (0x160/4)
+//word index of the registers inside an interface
+#define SIM_CRQ     0
+#define SIM_CMSK    1
+#define SIM_MSK1    2
+#define SIM_MSK2    3
+#define SIM_ARB1    4
+#define SIM_ARB2    5
+#define SIM_MCTL    6
+#define SIM_DA1     7
+#define SIM_DA2     8
+#define SIM_DB1     9
+#define SIM_DB2     10
+
+//CANCTL
+#define CTL_INIT    0x0001
+#define CTL_IE      0x0002
+#define CTL_SIE     0x0004
+#define CTL_EIE     0x0008
+#define CTL_TEST    0x0080
+//CANSTS
+#define STS_LEC     0x0007
+#define STS_TXOK    0x0008
+#define STS_RXOK    0x0010
+#define STS_EPASS   0x0020
+#define STS_EWARN   0x0040
+#define STS_BOFF    0x0080
+//CANERR
+#define ERR_RP      0x8000
+//CANTST
+#define TST_SILENT  0x0008
+#define TST_LBACK   0x0010
+//CANIFnCMSK
+#define CMSK_WRNRD  0x0080
+#define CMSK_MASK   0x0040
+#define CMSK_ARB    0x0020
+#define CMSK_CONTROL 0x0010
+#define CMSK_CLRINTPND 0x0008
+#define CMSK_NEWDAT 0x0004  //TXRQST when writing
+#define CMSK_DATAA  0x0002
+#define CMSK_DATAB  0x0001
+//CANIFnMSK2
+#define MSK2_MXTD   0x8000
+//CANIFnARB2
+#define ARB2_MSGVAL 0x8000
+#define ARB2_XTD    0x4000
+#define ARB2_DIR    0x2000
+//CANIFnMCTL
+#define MCTL_NEWDAT 0x8000
+#define MCTL_MSGLST 0x4000
+#define MCTL_INTPND 0x2000
+#define MCTL_UMASK  0x1000
+#define MCTL_TXIE   0x0800
+#define MCTL_RXIE   0x0400
+#define MCTL_RMTEN  0x0200
+#define MCTL_TXRQST 0x0100
+#define MCTL_EOB    0x0080
+#define MCTL_DLC    0x000F
+
+#define ID_FIELD_MASK 0x1FFFFFFF
+/*******************************************************************************
+ *                         Types Declaration                                   *
+ *******************************************************************************/
+typedef struct {
+    uint16 msk1, msk2, arb1, arb2, mctl;
+    uint16 da1, da2, db1, db2;
+}can_simObject;
+typedef struct {
+    volatile uint32_t reg[SIM_REG_WORDS];
+    can_simObject ram[CAN_SIM_MSG_OBJECTS];
+    bool statusPending;
+    uint32 txrq, nwda, msgint, msgval; //bitmaps of the message ram, bit i for object i+1
+    uint32 errorBits;   //BOFF/EPASS/EWARN, kept when the driver writes CANSTS
+    bool recovering;    //INIT cleared while bus-off, waiting for 129x11 recessive bits
+    uint64 recoverAtNs;
+    bool inIsr;
+    can_simIsr isr;
+}can_simModule;
+typedef struct {
+    uint32 address;
+    volatile uint32_t value;
+}can_simPlainReg;
+/*******************************************************************************
+ *                         Global Variables                                    *
+ *******************************************************************************/
+static can_simModule simModule[CAN_SIM_MODULES];
+static can_simPlainReg simPlain[SIM_PLAIN_REGS];
+static volatile uint32_t simScratch;
+static uint32 simSysClock = 16000000;
+static uint64 simTimeNs;
+static uint32 simFrameCount;
+static bool simAutoBus;
+static bool simIrqMasked;
+static bool simBusActive;
+static can_simFrame simLog[CAN_SIM_BUS_LOG_SIZE];
+static uint32 simLogHead, simLogTail;
+static can_simFrame simExtQueue[CAN_SIM_EXT_QUEUE_SIZE];
+static uint32 simExtHead, simExtTail;
+/*******************************************************************************
+ *                      Private Functions                                      *
+ *******************************************************************************/
+/*
+ * Description : updates the bits of one message object in the read only
+ *               bitmaps, called after its control word or MSGVAL changed
+ */
+static void sim_objectChanged(can_simModule* m, uint8 i)
+{
+    uint32 bit= 1UL<<i;
+    uint32 half= i>>4;
+    uint16 mctl= m->ram[i].mctl;
+
+    m->txrq= (mctl & MCTL_TXRQST) ? (m->txrq | bit) : (m->txrq & ~bit);
+    m->nwda= (mctl & MCTL_NEWDAT) ? (m->nwda | bit) : (m->nwda & ~bit);
+    m->msgint= (mctl & MCTL_INTPND) ? (m->msgint | bit) : (m->msgint & ~bit);
+    m->msgval= (m->ram[i].arb2 & ARB2_MSGVAL) ? (m->msgval | bit) : (m->msgval & ~bit);
+    m->reg[SIM_TXRQ1+half]= (m->txrq>>(16*half)) & 0xFFFF;
+    m->reg[SIM_NWDA1+half]= (m->nwda>>(16*half)) & 0xFFFF;
+    m->reg[SIM_MSG1INT+half]= (m->msgint>>(16*half)) & 0xFFFF;
+    m->reg[SIM_MSG1VAL+half]= (m->msgval>>(16*half)) & 0xFFFF;
+}
+/*
+ * Description : executes the command request written to one interface
+ *               in the direction selected by WRNRD
+ */
+static void sim_transfer(can_simModule* m, uint32 ifBase)
+{
+    volatile uint32_t* ifr= &m->reg[ifBase];
+    uint32 cmsk= ifr[SIM_CMSK];
+    uint32 num= ifr[SIM_CRQ] & 0x3F;
+    can_simObject* obj;
+
+    ifr[SIM_CRQ] &= ~0x3F; //transfer completes at once, BUSY stays clear
+    if (num < 1 || num > CAN_SIM_MSG_OBJECTS)
+    {
+        return;
+    }
+    obj= &m->ram[num-1];
+    if (cmsk & CMSK_WRNRD) //interface registers to message ram
+    {
+        if (cmsk & CMSK_MASK)
+        {
+            obj->msk1= ifr[SIM_MSK1];
+            obj->msk2= ifr[SIM_MSK2];
+        }
+        if (cmsk & CMSK_ARB)
+        {
+            obj->arb1= ifr[SIM_ARB1];
+            obj->arb2= ifr[SIM_ARB2];
+        }
+        if (cmsk & CMSK_CONTROL)
+        {
+            obj->mctl= ifr[SIM_MCTL];
+        }
+        if (cmsk & CMSK_DATAA)
+        {
+            obj->da1= ifr[SIM_DA1];
+            obj->da2= ifr[SIM_DA2];
+        }
+        if (cmsk & CMSK_DATAB)
+        {
+            obj->db1= ifr[SIM_DB1];
+            obj->db2= ifr[SIM_DB2];
+        }
+        if (cmsk & CMSK_NEWDAT) //TXRQST bit in the write direction
+        {
+            obj->mctl |= MCTL_TXRQST;
+        }
+    }
+    else //message ram to interface registers
+    {
+        if (cmsk & CMSK_MASK)
+        {
+            ifr[SIM_MSK1]= obj->msk1;
+            ifr[SIM_MSK2]= obj->msk2;
+        }
+        if (cmsk & CMSK_ARB)
+        {
+            ifr[SIM_ARB1]= obj->arb1;
+            ifr[SIM_ARB2]= obj->arb2;
+        }
+        if (cmsk & CMSK_CONTROL)
+        {
+            ifr[SIM_MCTL]= obj->mctl;
+        }
+        if (cmsk & CMSK_DATAA)
+        {
+            ifr[SIM_DA1]= obj->da1;
+            ifr[SIM_DA2]= obj->da2;
+        }
+        if (cmsk & CMSK_DATAB)
+        {
+            ifr[SIM_DB1]= obj->db1;
+            ifr[SIM_DB2]= obj->db2;
+        }
+        if (cmsk & CMSK_CLRINTPND)
+        {
+            obj->mctl &= ~MCTL_INTPND;
+        }
+        if (cmsk & CMSK_NEWDAT)
+        {
+            obj->mctl &= ~MCTL_NEWDAT;
+        }
+    }
+    sim_objectChanged(m, num-1);
+}
+/*
+ * Description : CANINT from the status interrupt and the lowest object with
+ *               its interrupt pending
+ */
+static void sim_updateInt(can_simModule* m)
+{
+    if (m->statusPending)
+    {
+        m->reg[SIM_INT]= 0x8000;
+    }
+    else
+    {
+        m->reg[SIM_INT]= m->msgint ? (uint32)__builtin_ctzl(m->msgint)+1 : 0;
+    }
+}
+/*
+ * Description : bit time programmed in CANBIT/CANBRPE of a module
+ */
+static uint64 sim_bitTimeNs(const can_simModule* m)
+{
+    uint32 bit= m->reg[SIM_BIT];
+    uint64 brp= (((m->reg[SIM_BRPE] & 0xF)<<6) | (bit & 0x3F)) + 1;
+    uint64 quanta= 1 + (((bit>>8) & 0xF)+1) + (((bit>>12) & 0x7)+1);
+
+    return (brp*quanta*1000000000ULL)/simSysClock;
+}
+/*
+ * Description : bus-off recovery: once INIT is cleared the module waits for
+ *               129 times 11 recessive bits, then BOFF is cleared, the error
+ *               counters are reset and a status interrupt is raised with EIE
+ */
+static void sim_recovery(can_simModule* m)
+{
+    if (!(m->reg[SIM_STS] & STS_BOFF) || (m->reg[SIM_CTL] & CTL_INIT))
+    {
+        m->recovering= FALSE;
+        return;
+    }
+    if (!m->recovering)
+    {
+        m->recovering= TRUE;
+        m->recoverAtNs= simTimeNs + 129*11*sim_bitTimeNs(m);
+    }
+    if (simTimeNs >= m->recoverAtNs)
+    {
+        m->recovering= FALSE;
+        m->errorBits= 0;
+        m->reg[SIM_STS] &= ~(STS_BOFF | STS_EPASS | STS_EWARN);
+        m->reg[SIM_ERR]= 0;
+        if (m->reg[SIM_CTL] & CTL_EIE)
+        {
+            m->statusPending= TRUE;
+        }
+    }
+}
+static void sim_sync(can_simModule* m)
+{
+    if (m->reg[SIM_IF1+SIM_CRQ] & 0x3F)
+    {
+        sim_transfer(m, SIM_IF1);
+    }
+    if (m->reg[SIM_IF2+SIM_CRQ] & 0x3F)
+    {
+        sim_transfer(m, SIM_IF2);
+    }
+    //the error state bits of CANSTS are read only
+    m->reg[SIM_STS]= (m->reg[SIM_STS] & ~(STS_BOFF | STS_EPASS | STS_EWARN)) | m->errorBits;
+    sim_recovery(m);
+    sim_updateInt(m);
+}
+static bool sim_onBus(const can_simModule* m)
+{
+    return (m->reg[SIM_CTL] & CTL_INIT) == 0;
+}
+static uint32 sim_testBits(const can_simModule* m)
+{
+    return (m->reg[SIM_CTL] & CTL_TEST) ? m->reg[SIM_TST] : 0;
+}
+static void sim_setStatus(can_simModule* m, uint32 bits)
+{
+    m->reg[SIM_STS]= (m->reg[SIM_STS] & ~0x07) | bits; //LEC = no error
+    if (m->reg[SIM_CTL] & CTL_SIE)
+    {
+        m->statusPending= TRUE;
+    }
+}
+/*
+ * Description : 29 bit identifier field as laid out in ARB1/ARB2,
+ *               standard ids occupy bits 28:18
+ */
+static uint32 sim_idField(uint32 ID, bool extended)
+{
+    return extended ? (ID & ID_FIELD_MASK) : ((ID & 0x7FF)<<18);
+}
+/*
+ * Description : arbitration field value, the lower value wins the bus
+ */
+static uint32 sim_arbitrationKey(const can_simFrame* f)
+{
+    uint32 key;
+    if (f->extended)
+    {   //base id, SRR, IDE, id extension, RTR
+        key= ((f->ID>>18) & 0x7FF)<<21 | 1UL<<20 | 1UL<<19 | (f->ID & 0x3FFFF)<<1 | f->remote;
+    }
+    else
+    {   //base id, RTR, IDE
+        key= (f->ID & 0x7FF)<<21 | (uint32)f->remote<<20;
+    }
+    return key;
+}
+static bool sim_accepts(const can_simObject* obj, const can_simFrame* f)
+{
+    uint32 objField= ((uint32)(obj->arb2 & 0x1FFF)<<16) | obj->arb1;
+    uint32 maskField= ID_FIELD_MASK;
+    bool objExtended= (obj->arb2 & ARB2_XTD) != 0;
+
+    if (obj->mctl & MCTL_UMASK)
+    {
+        maskField= ((uint32)(obj->msk2 & 0x1FFF)<<16) | obj->msk1;
+    }
+    if ((!(obj->mctl & MCTL_UMASK) || (obj->msk2 & MSK2_MXTD)) && objExtended != f->extended)
+    {
+        return FALSE;
+    }
+    return ((sim_idField(f->ID, f->extended) ^ objField) & maskField) == 0;
+}
+static void sim_frameFromObject(const can_simObject* obj, can_simFrame* f, uint8 source)
+{
+    f->extended= (obj->arb2 & ARB2_XTD) != 0;
+    if (f->extended)
+    {
+        f->ID= ((uint32)(obj->arb2 & 0x1FFF)<<16) | obj->arb1;
+    }
+    else
+    {
+        f->ID= (obj->arb2>>2) & 0x7FF;
+    }
+    f->remote= (obj->arb2 & ARB2_DIR) == 0; //TXRQST on a receive object requests remote data
+    f->dlc= obj->mctl & MCTL_DLC;
+    f->data[0]= obj->da1; f->data[1]= obj->da1>>8;
+    f->data[2]= obj->da2; f->data[3]= obj->da2>>8;
+    f->data[4]= obj->db1; f->data[5]= obj->db1>>8;
+    f->data[6]= obj->db2; f->data[7]= obj->db2>>8;
+    f->source= source;
+}
+/*
+ * Description : message handler of a receiving module, scans the objects
+ *               from the lowest number and skips full FIFO members (EOB=0)
+ */
+static void sim_receive(can_simModule* m, const can_simFrame* f)
+{
+    uint32 valid;
+    uint8 i;
+
+    for (valid= m->msgval; valid != 0; valid &= valid-1)
+    {
+        can_simObject* obj;
+
+        i= (uint8)__builtin_ctzl(valid);
+        obj= &m->ram[i];
+        if (!sim_accepts(obj, f))
+        {
+            continue;
+        }
+        if (f->remote)
+        {   //remote frames only trigger matching transmit objects
+            if ((obj->arb2 & ARB2_DIR) && (obj->mctl & MCTL_RMTEN))
+            {
+                obj->mctl |= MCTL_TXRQST;
+                sim_objectChanged(m, i);
+                break;
+            }
+            continue;
+        }
+        if (obj->arb2 & ARB2_DIR)
+        {
+            continue;
+        }
+        if ((obj->mctl & MCTL_NEWDAT) && !(obj->mctl & MCTL_EOB))
+        {
+            continue; //next member of the fifo
+        }
+        if (obj->mctl & MCTL_NEWDAT)
+        {
+            obj->mctl |= MCTL_MSGLST;
+        }
+        if (f->extended)
+        {
+            obj->arb1= f->ID & 0xFFFF;
+            obj->arb2= (obj->arb2 & 0xE000) | ((f->ID>>16) & 0x1FFF);
+        }
+        else
+        {
+            obj->arb2= (obj->arb2 & 0xE000) | ((f->ID & 0x7FF)<<2);
+        }
+        //a data frame ends the remote request of the object
+        obj->mctl= (obj->mctl & ~(MCTL_DLC | MCTL_TXRQST)) | f->dlc | MCTL_NEWDAT;
+        if (obj->mctl & MCTL_RXIE)
+        {
+            obj->mctl |= MCTL_INTPND;
+        }
+        obj->da1= f->data[0] | f->data[1]<<8;
+        obj->da2= f->data[2] | f->data[3]<<8;
+        obj->db1= f->data[4] | f->data[5]<<8;
+        obj->db2= f->data[6] | f->data[7]<<8;
+        sim_objectChanged(m, i);
+        sim_setStatus(m, STS_RXOK);
+        break;
+    }
+    sim_updateInt(m);
+}
+/*
+ * Description : nominal frame duration without stuff bits, using the bit
+ *               timing programmed in CANBIT/CANBRPE of the given module
+ */
+static uint64 sim_frameTimeNs(const can_simModule* m, const can_simFrame* f)
+{
+    uint64 bits= f->extended ? 64 : 44;
+
+    if (!f->remote)
+    {
+        bits += 8*(f->dlc > 8 ? 8 : f->dlc);
+    }
+    bits += 3; //interframe space
+    return bits*sim_bitTimeNs(m);
+}
+static void sim_serviceIsr(uint8 module)
+{
+    can_simModule* m= &simModule[module];
+    uint8 guard= 0;
+
+    if (m->isr == 0 || m->inIsr || simIrqMasked)
+    {
+        return;
+    }
+    m->inIsr= TRUE;
+    while ((m->reg[SIM_CTL] & CTL_IE) && m->reg[SIM_INT] != 0 && guard++ < CAN_SIM_MSG_OBJECTS+1)
+    {
+        m->isr();
+        sim_sync(m);
+    }
+    m->inIsr= FALSE;
+}
+static bool sim_pendingTransmit(void)
+{
+    uint8 mod;
+    for (mod=0; mod<CAN_SIM_MODULES; mod++)
+    {
+        if (sim_onBus(&simModule[mod]) && (simModule[mod].reg[SIM_TXRQ1] | simModule[mod].reg[SIM_TXRQ1+1]))
+        {
+            return TRUE;
+        }
+    }
+    return simExtHead != simExtTail;
+}
+static can_simModule* sim_moduleOf(volatile void* regs)
+{
+    uint8 mod;
+    for (mod=0; mod<CAN_SIM_MODULES; mod++)
+    {
+        volatile uint32_t* reg= (volatile uint32_t*)regs;
+        if (reg >= simModule[mod].reg && reg < simModule[mod].reg+SIM_REG_WORDS)
+        {
+            return &simModule[mod];
+        }
+    }
+    return 0;
+}
+/*
+ * Description : brings a module up to date before a register access: pending
+ *               transfers are done, a status read clears the status interrupt
+ *               and the bus runs if it is in automatic mode
+ */
+static void sim_access(can_simModule* m, bool statusRead)
+{
+    sim_sync(m);
+    if (statusRead) //reading CANSTS clears the status interrupt
+    {
+        m->statusPending= FALSE;
+        sim_updateInt(m);
+    }
+    if (simAutoBus && !simBusActive && sim_pendingTransmit())
+    {
+        can_sim_runBus(0xFFFFFFFF);
+    }
+}
+/*******************************************************************************
+ *                      Functions Definitions                                  *
+ *******************************************************************************/
+/*
+ * Description : Function to put both modules in their reset state
+ *
+ *  Arguments: system clock in Hz used to derive the bit time
+ *  Returns: void
+ */
+void can_sim_reset(uint32 sysClock)
+{
+    uint8 mod, i;
+
+    memset(simModule, 0, sizeof(simModule));
+    memset(simPlain, 0, sizeof(simPlain));
+    for (mod=0; mod<CAN_SIM_MODULES; mod++)
+    {
+        can_simModule* m= &simModule[mod];
+        m->reg[SIM_CTL]= CTL_INIT;
+        m->reg[SIM_BIT]= 0x2301;
+        for (i=0; i<2; i++)
+        {
+            uint32 ifBase= i ? SIM_IF2 : SIM_IF1;
+            m->reg[ifBase+SIM_CRQ]= 0x0001;
+            m->reg[ifBase+SIM_MSK1]= 0xFFFF;
+            m->reg[ifBase+SIM_MSK2]= 0xFFFF;
+        }
+    }
+    simSysClock= sysClock ? sysClock : 16000000;
+    simTimeNs= 0;
+    simFrameCount= 0;
+    simAutoBus= FALSE;
+    simBusActive= FALSE;
+    simIrqMasked= FALSE;
+    simLogHead= simLogTail= 0;
+    simExtHead= simExtTail= 0;
+}
+/*
+ * Description : Function that every redirected register macro goes through.
+ *               Pending command transfers of the accessed module are done
+ *               first so the access sees the state after the transfer.
+ *
+ *  Arguments: physical address of the register
+ *  Returns: pointer to the modelled register
+ */
+volatile uint32_t* can_sim_reg(uint32 address)
+{
+    uint8 i;
+
+    if (address >= CAN0_BASE_ADDRESS && address < CAN1_BASE_ADDRESS+CAN_MODULE_SPAN)
+    {
+        can_simModule* m= &simModule[(address-CAN0_BASE_ADDRESS)/CAN_MODULE_SPAN];
+        uint32 word= (address & (CAN_MODULE_SPAN-1))/4;
+
+        sim_access(m, word == SIM_STS);
+        return word < SIM_REG_WORDS ? &m->reg[word] : &simScratch;
+    }
+    for (i=0; i<SIM_PLAIN_REGS; i++)
+    {
+        if (simPlain[i].address == address || simPlain[i].address == 0)
+        {
+            simPlain[i].address= address;
+            return &simPlain[i].value;
+        }
+    }
+    return &simScratch;
+}
+/*
+ * Description : Function giving the register block of a module for drivers
+ *               that lay a register map over the base address
+ *
+ *  Arguments: module number
+ *  Returns: pointer to the first register (CANCTL)
+ */
+volatile void* can_sim_regs(uint8 module)
+{
+    return simModule[module < CAN_SIM_MODULES ? module : 0].reg;
+}
+/*
+ * Description : Function to call after writing a command request through a
+ *               register block pointer, executes the transfer
+ *
+ *  Arguments: pointer into a register block returned by can_sim_regs()
+ *  Returns: void
+ */
+void can_sim_sync(volatile void* regs)
+{
+    can_simModule* m= sim_moduleOf(regs);
+    if (m != 0)
+    {
+        sim_access(m, FALSE);
+    }
+}
+/*
+ * Description : Function to call after reading CANSTS through a register
+ *               block pointer, clears the status interrupt
+ *
+ *  Arguments: pointer into a register block returned by can_sim_regs()
+ *  Returns: void
+ */
+void can_sim_statusRead(volatile void* regs)
+{
+    can_simModule* m= sim_moduleOf(regs);
+    if (m != 0)
+    {
+        sim_access(m, TRUE);
+    }
+}
+/*
+ * Description : Function to complete every pending command transfer
+ *
+ *  Arguments: void
+ *  Returns: void
+ */
+void can_sim_flush(void)
+{
+    uint8 mod;
+    for (mod=0; mod<CAN_SIM_MODULES; mod++)
+    {
+        sim_sync(&simModule[mod]);
+    }
+}
+/*
+ * Description : Function to hold the BUSY bit of an interface set, so the
+ *               driver times out waiting for it, or to release it again
+ *
+ *  Arguments: module number, interface (1 or 2), TRUE to hold BUSY set
+ *  Returns: void
+ */
+void can_sim_setBusy(uint8 module, uint8 ifn, bool busy)
+{
+    can_simModule* m;
+    volatile uint32_t* crq;
+
+    if (module >= CAN_SIM_MODULES || ifn < 1 || ifn > 2)
+    {
+        return;
+    }
+    m= &simModule[module];
+    sim_sync(m); //a pending transfer completes before BUSY is taken
+    crq= &m->reg[(ifn == 1 ? SIM_IF1 : SIM_IF2)+SIM_CRQ];
+    if (busy)
+    {
+        *crq |= 0x8000;
+    }
+    else
+    {
+        *crq &= ~0x8000;
+    }
+}
+/*
+ * Description : Function to register the interrupt handler called when
+ *               CANINT is non zero and IE is set after a bus event
+ *
+ *  Arguments: module number, handler (0 to remove it)
+ *  Returns: void
+ */
+void can_sim_setIsr(uint8 module, can_simIsr isr)
+{
+    if (module < CAN_SIM_MODULES)
+    {
+        simModule[module].isr= isr;
+    }
+}
+/*
+ * Description : Function to run the bus from inside register accesses
+ *               whenever a transmission is pending
+ *
+ *  Arguments: TRUE to run the bus automatically
+ *  Returns: void
+ */
+void can_sim_setAutoBus(bool enable)
+{
+    simAutoBus= enable;
+}
+/*
+ * Description : Function to mask the simulated interrupts, the host
+ *               counterpart of setting PRIMASK
+ *
+ *  Arguments: void
+ *  Returns: previous mask state to pass to can_sim_exitCritical()
+ */
+uint32 can_sim_enterCritical(void)
+{
+    uint32 previous= simIrqMasked;
+    simIrqMasked= TRUE;
+    return previous;
+}
+/*
+ * Description : Function to restore the interrupt mask, interrupts that
+ *               became pending while masked are serviced when unmasking
+ *
+ *  Arguments: state returned by can_sim_enterCritical()
+ *  Returns: void
+ */
+void can_sim_exitCritical(uint32 state)
+{
+    uint8 mod;
+
+    simIrqMasked= state ? TRUE : FALSE;
+    if (!simIrqMasked)
+    {
+        for (mod=0; mod<CAN_SIM_MODULES; mod++)
+        {
+            sim_sync(&simModule[mod]);
+            sim_serviceIsr(mod);
+        }
+    }
+}
+/*
+ * Description : Function to report a bus error seen by a module: LEC is set
+ *               and the error counters are replaced, EWARN (96), EPASS (128)
+ *               and BOFF (transmit counter above 255, the module then sets
+ *               INIT) follow from them. A status interrupt is raised for the
+ *               error code with SIE and for a change of BOFF or EWARN with EIE.
+ *
+ *  Arguments: module number, error code (CAN_STS_LEC_xxx), transmit error
+ *             counter 0..256, receive error counter 0..255
+ *  Returns: void
+ */
+void can_sim_busError(uint8 module, uint8 lec, uint16 tec, uint8 rec)
+{
+    can_simModule* m;
+    uint32 old, sts;
+
+    if (module >= CAN_SIM_MODULES)
+    {
+        return;
+    }
+    m= &simModule[module];
+    sim_sync(m);
+    old= m->reg[SIM_STS];
+    sts= (old & ~(STS_LEC | STS_EPASS | STS_EWARN | STS_BOFF)) | (lec & STS_LEC);
+    if (tec > 255)
+    {
+        sts |= STS_BOFF | STS_EPASS | STS_EWARN;
+        m->reg[SIM_CTL] |= CTL_INIT;
+        tec= 255;
+    }
+    else
+    {
+        if (tec >= 128 || rec >= 128)
+        {
+            sts |= STS_EPASS;
+        }
+        if (tec >= 96 || rec >= 96)
+        {
+            sts |= STS_EWARN;
+        }
+    }
+    m->reg[SIM_STS]= sts;
+    m->errorBits= sts & (STS_BOFF | STS_EPASS | STS_EWARN);
+    m->reg[SIM_ERR]= (rec >= 128 ? ERR_RP : 0) | (uint32)(rec & 0x7F)<<8 | tec;
+    if (((m->reg[SIM_CTL] & CTL_SIE) && (lec & STS_LEC) != 0 && (lec & STS_LEC) != STS_LEC) ||
+            ((m->reg[SIM_CTL] & CTL_EIE) && ((sts ^ old) & (STS_BOFF | STS_EWARN))))
+    {
+        m->statusPending= TRUE;
+    }
+    sim_updateInt(m);
+    sim_serviceIsr(module);
+}
+/*
+ * Description : Function to queue a frame sent by a node outside the chip
+ *
+ *  Arguments: pointer to the frame
+ *  Returns: FALSE if the external node queue is full
+ */
+bool can_sim_inject(const can_simFrame* framePtr)
+{
+    if (simExtHead-simExtTail >= CAN_SIM_EXT_QUEUE_SIZE)
+    {
+        return FALSE;
+    }
+    simExtQueue[simExtHead & (CAN_SIM_EXT_QUEUE_SIZE-1)]= *framePtr;
+    simExtQueue[simExtHead & (CAN_SIM_EXT_QUEUE_SIZE-1)].source= CAN_SIM_EXTERNAL_NODE;
+    simExtHead++;
+    return TRUE;
+}
+/*
+ * Description : Function to put one frame on the bus. Every node with a
+ *               pending request takes part in arbitration, inside a module
+ *               the lowest message object number is sent first.
+ *
+ *  Arguments: void
+ *  Returns: TRUE if a frame was transmitted
+ */
+bool can_sim_busStep(void)
+{
+    can_simFrame candidate, winner;
+    can_simObject* winnerObj= 0;
+    sint32 winnerSource= -1;
+    uint32 requested;
+    uint8 mod, winnerIndex= 0;
+    bool found= FALSE;
+
+    simBusActive= TRUE;
+    for (mod=0; mod<CAN_SIM_MODULES; mod++)
+    {
+        can_simModule* m= &simModule[mod];
+        sim_sync(m);
+        if (!sim_onBus(m))
+        {
+            continue;
+        }
+        requested= m->txrq & m->msgval;
+        if (requested != 0)
+        {   //lowest object number first
+            uint8 i= (uint8)__builtin_ctzl(requested);
+            sim_frameFromObject(&m->ram[i], &candidate, mod);
+            if (!found || sim_arbitrationKey(&candidate) < sim_arbitrationKey(&winner))
+            {
+                winner= candidate;
+                winnerObj= &m->ram[i];
+                winnerIndex= i;
+                winnerSource= mod;
+                found= TRUE;
+            }
+        }
+    }
+    if (simExtHead != simExtTail)
+    {
+        candidate= simExtQueue[simExtTail & (CAN_SIM_EXT_QUEUE_SIZE-1)];
+        if (!found || sim_arbitrationKey(&candidate) < sim_arbitrationKey(&winner))
+        {
+            winner= candidate;
+            winnerObj= 0;
+            winnerSource= CAN_SIM_EXTERNAL_NODE;
+            found= TRUE;
+        }
+    }
+    if (!found)
+    {
+        simBusActive= FALSE;
+        return FALSE;
+    }
+
+    simTimeNs += sim_frameTimeNs(&simModule[winnerSource == CAN_SIM_EXTERNAL_NODE ? 0 : winnerSource], &winner);
+    winner.timeNs= simTimeNs;
+    if (winnerSource == CAN_SIM_EXTERNAL_NODE)
+    {
+        simExtTail++;
+    }
+    else
+    {
+        can_simModule* m= &simModule[winnerSource];
+        winnerObj->mctl &= ~MCTL_TXRQST;
+        if (winnerObj->mctl & MCTL_TXIE)
+        {
+            winnerObj->mctl |= MCTL_INTPND;
+        }
+        sim_objectChanged(m, winnerIndex);
+        sim_setStatus(m, STS_TXOK);
+        if (sim_testBits(m) & TST_LBACK)
+        {
+            sim_receive(m, &winner);
+        }
+        sim_updateInt(m);
+    }
+    if (winnerSource == CAN_SIM_EXTERNAL_NODE || !(sim_testBits(&simModule[winnerSource]) & TST_SILENT))
+    {
+        for (mod=0; mod<CAN_SIM_MODULES; mod++)
+        {
+            can_simModule* m= &simModule[mod];
+            if (mod != winnerSource && sim_onBus(m) && !(sim_testBits(m) & TST_LBACK))
+            {
+                sim_receive(m, &winner);
+            }
+        }
+    }
+    simLog[simLogHead & (CAN_SIM_BUS_LOG_SIZE-1)]= winner;
+    simLogHead++;
+    if (simLogHead-simLogTail > CAN_SIM_BUS_LOG_SIZE)
+    {
+        simLogTail= simLogHead-CAN_SIM_BUS_LOG_SIZE; //drop the oldest entry
+    }
+    simFrameCount++;
+    for (mod=0; mod<CAN_SIM_MODULES; mod++)
+    {
+        sim_sync(&simModule[mod]);
+        sim_serviceIsr(mod);
+    }
+    simBusActive= FALSE;
+    return TRUE;
+}
+/*
+ * Description : Function to run the bus until it is idle
+ *
+ *  Arguments: maximum number of frames to transmit
+ *  Returns: number of frames transmitted
+ */
+uint32 can_sim_runBus(uint32 maxFrames)
+{
+    uint32 frames= 0;
+    while (frames < maxFrames && can_sim_busStep())
+    {
+        frames++;
+    }
+    return frames;
+}
+/*
+ * Description : Function to read the oldest frame of the bus log
+ *
+ *  Arguments: pointer to the frame to fill
+ *  Returns: FALSE if the log is empty
+ */
+bool can_sim_readBusLog(can_simFrame* framePtr)
+{
+    if (simLogHead == simLogTail)
+    {
+        return FALSE;
+    }
+    *framePtr= simLog[simLogTail & (CAN_SIM_BUS_LOG_SIZE-1)];
+    simLogTail++;
+    return TRUE;
+}
+/*
+ * Description : Function to let time pass on an idle bus, e.g. to complete
+ *               a bus-off recovery or wait for a back-off delay
+ *
+ *  Arguments: time in ns
+ *  Returns: void
+ */
+void can_sim_advanceTime(uint64 ns)
+{
+    uint8 mod;
+
+    for (mod=0; mod<CAN_SIM_MODULES; mod++)
+    {
+        sim_sync(&simModule[mod]); //a recovery started before counts from now
+    }
+    simTimeNs += ns;
+    for (mod=0; mod<CAN_SIM_MODULES; mod++)
+    {
+        sim_sync(&simModule[mod]);
+        sim_serviceIsr(mod);
+    }
+}
+/*
+ * Description : Function giving the host monotonic clock, the cycle counter
+ *               of CAN_PROFILE on the host
+ *
+ *  Arguments: void
+ *  Returns: nanoseconds, wrapping at 2^32
+ */
+uint32 can_sim_monotonicNs(void)
+{
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint32)(((uint64)now.tv_sec*1000000000ULL + (uint64)now.tv_nsec) & 0xFFFFFFFF);
+}
+uint64 can_sim_getTimeNs(void)
+{
+    return simTimeNs;
+}
+uint32 can_sim_getFrameCount(void)
+{
+    return simFrameCount;
+}
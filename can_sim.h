@@ -0,0 +1,167 @@
+/*
+ * File name: can_sim.h
+ *
+ *  Host-side register level model of the two Bosch C_CAN cores of the
+ *  TM4C123GH6PM. When the driver is compiled with CAN_HOST_SIM defined the
+ *  register macros of tm4c123gh6pm.h used by can.c are redirected to this
+ *  model so the driver runs unchanged on a normal PC.
+ *
+ *  The model covers:
+ *      - the CANCTL/STS/ERR/BIT/INT/TST/BRPE registers
+ *      - IF1/IF2 command request transfers to and from the message RAM
+ *      - 32 message objects per module
+ *      - the TXRQ, NWDA, MSGINT and MSGVAL bitmaps
+ *      - a bus joining CAN0, CAN1 and an external node with ID arbitration,
+ *        acceptance filtering, remote frames and loopback/silent test modes
+ *
+ *  Deviations from the silicon:
+ *      - command transfers are executed on the next register access of the
+ *        same module (or on can_sim_flush()), BUSY never reads as set unless
+ *        held with can_sim_setBusy() and the MNUM field reads back as 0 once
+ *        the transfer is done
+ *      - any access to CANSTS counts as a read and clears the status interrupt
+ *      - code using a register block pointer from can_sim_regs() instead of
+ *        the register macros calls can_sim_sync() after writing CRQ and
+ *        can_sim_statusRead() after reading CANSTS
+ *      - frames are never corrupted, every frame is acknowledged; bus errors
+ *        and error counters are only set with can_sim_busError(); a bus-off
+ *        recovery takes 129x11 bit times of bus time, which only advances with
+ *        frames or can_sim_advanceTime()
+ */
+
+#ifndef CAN_SIM_H_
+#define CAN_SIM_H_
+#include <stdint.h>
+#include "tm4c123gh6pm.h"
+#include "std_types.h"
+/*******************************************************************************
+ *                         Definitions                                         *
+ *******************************************************************************/
+#define CAN_SIM_MODULES         2
+#define CAN_SIM_MSG_OBJECTS     32
+#define CAN_SIM_BUS_LOG_SIZE    64    //frames kept in the bus log, power of 2
+#define CAN_SIM_EXT_QUEUE_SIZE  64    //frames the external node can queue, power of 2
+#define CAN_SIM_EXTERNAL_NODE   0xFF  //source of frames sent with can_sim_inject()
+
+/* every register access goes through the model */
+#define CAN_SIM_REG(address)    (*can_sim_reg(address))
+/*******************************************************************************
+ *                         Types Declaration                                   *
+ *******************************************************************************/
+typedef struct {
+    uint32 ID;
+    bool extended;      //29 bit id
+    bool remote;        //remote frame
+    uint8 dlc;
+    uint8 data[8];
+    uint8 source;       //0 or 1 for CAN0/CAN1, CAN_SIM_EXTERNAL_NODE otherwise
+    uint64 timeNs;      //bus time at the end of the frame
+}can_simFrame;
+typedef void (*can_simIsr)(void);
+/*******************************************************************************
+ *                      Functions Prototypes                                   *
+ *******************************************************************************/
+void can_sim_reset(uint32 sysClock);
+volatile uint32_t* can_sim_reg(uint32 address);
+volatile void* can_sim_regs(uint8 module);
+void can_sim_sync(volatile void* regs);
+void can_sim_statusRead(volatile void* regs);
+void can_sim_flush(void);
+void can_sim_setBusy(uint8 module, uint8 ifn, bool busy);
+void can_sim_setIsr(uint8 module, can_simIsr isr);
+void can_sim_setAutoBus(bool enable);
+uint32 can_sim_enterCritical(void);
+void can_sim_exitCritical(uint32 state);
+bool can_sim_inject(const can_simFrame* framePtr);
+void can_sim_busError(uint8 module, uint8 lec, uint16 tec, uint8 rec);
+bool can_sim_busStep(void);
+uint32 can_sim_runBus(uint32 maxFrames);
+bool can_sim_readBusLog(can_simFrame* framePtr);
+uint64 can_sim_getTimeNs(void);
+void can_sim_advanceTime(uint64 ns);
+uint32 can_sim_monotonicNs(void);
+uint32 can_sim_getFrameCount(void);
+
+/*******************************************************************************
+ *                      Register Redirection                                   *
+ *******************************************************************************/
+#undef  GPIO_PORTA_AFSEL_R
+#define GPIO_PORTA_AFSEL_R      CAN_SIM_REG(0x40004420)
+#undef  GPIO_PORTA_DEN_R
+#define GPIO_PORTA_DEN_R        CAN_SIM_REG(0x4000451C)
+#undef  GPIO_PORTA_AMSEL_R
+#define GPIO_PORTA_AMSEL_R      CAN_SIM_REG(0x40004528)
+#undef  GPIO_PORTA_PCTL_R
+#define GPIO_PORTA_PCTL_R       CAN_SIM_REG(0x4000452C)
+#undef  GPIO_PORTB_AFSEL_R
+#define GPIO_PORTB_AFSEL_R      CAN_SIM_REG(0x40005420)
+#undef  GPIO_PORTB_DEN_R
+#define GPIO_PORTB_DEN_R        CAN_SIM_REG(0x4000551C)
+#undef  GPIO_PORTB_AMSEL_R
+#define GPIO_PORTB_AMSEL_R      CAN_SIM_REG(0x40005528)
+#undef  GPIO_PORTB_PCTL_R
+#define GPIO_PORTB_PCTL_R       CAN_SIM_REG(0x4000552C)
+#undef  CAN0_CTL_R
+#define CAN0_CTL_R              CAN_SIM_REG(0x40040000)
+#undef  CAN0_STS_R
+#define CAN0_STS_R              CAN_SIM_REG(0x40040004)
+#undef  CAN0_ERR_R
+#define CAN0_ERR_R              CAN_SIM_REG(0x40040008)
+#undef  CAN0_BIT_R
+#define CAN0_BIT_R              CAN_SIM_REG(0x4004000C)
+#undef  CAN0_INT_R
+#define CAN0_INT_R              CAN_SIM_REG(0x40040010)
+#undef  CAN0_TST_R
+#define CAN0_TST_R              CAN_SIM_REG(0x40040014)
+#undef  CAN0_BRPE_R
+#define CAN0_BRPE_R             CAN_SIM_REG(0x40040018)
+#undef  CAN0_NWDA1_R
+#define CAN0_NWDA1_R            CAN_SIM_REG(0x40040120)
+#undef  CAN0_NWDA2_R
+#define CAN0_NWDA2_R            CAN_SIM_REG(0x40040124)
+#undef  CAN0_MSG1INT_R
+#define CAN0_MSG1INT_R          CAN_SIM_REG(0x40040140)
+#undef  CAN0_MSG2INT_R
+#define CAN0_MSG2INT_R          CAN_SIM_REG(0x40040144)
+#undef  CAN0_MSG1VAL_R
+#define CAN0_MSG1VAL_R          CAN_SIM_REG(0x40040160)
+#undef  CAN0_MSG2VAL_R
+#define CAN0_MSG2VAL_R          CAN_SIM_REG(0x40040164)
+#undef  CAN1_CTL_R
+#define CAN1_CTL_R              CAN_SIM_REG(0x40041000)
+#undef  CAN1_STS_R
+#define CAN1_STS_R              CAN_SIM_REG(0x40041004)
+#undef  CAN1_ERR_R
+#define CAN1_ERR_R              CAN_SIM_REG(0x40041008)
+#undef  CAN1_BIT_R
+#define CAN1_BIT_R              CAN_SIM_REG(0x4004100C)
+#undef  CAN1_INT_R
+#define CAN1_INT_R              CAN_SIM_REG(0x40041010)
+#undef  CAN1_TST_R
+#define CAN1_TST_R              CAN_SIM_REG(0x40041014)
+#undef  CAN1_BRPE_R
+#define CAN1_BRPE_R             CAN_SIM_REG(0x40041018)
+#undef  CAN1_NWDA1_R
+#define CAN1_NWDA1_R            CAN_SIM_REG(0x40041120)
+#undef  CAN1_NWDA2_R
+#define CAN1_NWDA2_R            CAN_SIM_REG(0x40041124)
+#undef  CAN1_MSG1INT_R
+#define CAN1_MSG1INT_R          CAN_SIM_REG(0x40041140)
+#undef  CAN1_MSG2INT_R
+#define CAN1_MSG2INT_R          CAN_SIM_REG(0x40041144)
+#undef  CAN1_MSG1VAL_R
+#define CAN1_MSG1VAL_R          CAN_SIM_REG(0x40041160)
+#undef  CAN1_MSG2VAL_R
+#define CAN1_MSG2VAL_R          CAN_SIM_REG(0x40041164)
+#undef  NVIC_INT_CTRL_R
+#define NVIC_INT_CTRL_R         CAN_SIM_REG(0xE000ED04)
+#undef  NVIC_SW_TRIG_R
+#define NVIC_SW_TRIG_R          CAN_SIM_REG(0xE000EF00)
+#undef  NVIC_EN1_R
+#define NVIC_EN1_R              CAN_SIM_REG(0xE000E104)
+#undef  SYSCTL_RCGC0_R
+#define SYSCTL_RCGC0_R          CAN_SIM_REG(0x400FE100)
+#undef  SYSCTL_RCGC2_R
+#define SYSCTL_RCGC2_R          CAN_SIM_REG(0x400FE108)
+
+#endif /* CAN_SIM_H_ */
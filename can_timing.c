@@ -0,0 +1,211 @@
+/*
+ * File name: can_timing.c
+ *
+ *  Bit timing solver for the C_CAN bit timing logic, integer arithmetic only
+ */
+#include "can.h"
+#if CAN_BIT_TIMING_SOLVER
+/*******************************************************************************
+ *                         Definitions                                         *
+ *******************************************************************************/
+#define CAN_QUANTA_MIN      4
+#define CAN_QUANTA_MAX      25
+#define CAN_PRESCALER_MAX   1024    //6 bits of CANBIT.BRP and 4 bits of CANBRPE
+#define CAN_TSEG1_MAX       16
+#define CAN_TSEG2_MIN       2       //information processing time
+#define CAN_TSEG2_MAX       8
+#define CAN_SJW_MAX         4
+/*******************************************************************************
+ *                      Private Functions                                      *
+ *******************************************************************************/
+static uint32 can_absDiff(uint32 a, uint32 b)
+{
+    return a > b ? a-b : b-a;
+}
+/*
+ * Description : prescaler giving the closest bit rate for a quanta count
+ *
+ *  Returns: 0 if it is out of the 1..1024 range
+ */
+static uint32 can_prescalerFor(const can_bitTimingRequest* requestPtr, uint8 quanta)
+{
+    uint64 clocksPerBit=(uint64)requestPtr->bitRate*quanta;
+    uint64 prescaler=((uint64)requestPtr->Fsys + clocksPerBit/2)/clocksPerBit;
+
+    return (prescaler < 1 || prescaler > CAN_PRESCALER_MAX) ? 0 : (uint32)prescaler;
+}
+static uint32 can_rateError(const can_bitTimingRequest* requestPtr, uint32 prescaler, uint8 quanta)
+{
+    uint32 rate=requestPtr->Fsys/(prescaler*quanta);
+    return (uint32)((uint64)can_absDiff(rate, requestPtr->bitRate)*1000000/requestPtr->bitRate);
+}
+/*
+ * Description : splits one quanta count into the bit segments
+ *
+ *  Returns: FALSE if the propagation delay does not fit
+ */
+static bool can_splitBit(const can_bitTimingRequest* requestPtr, uint32 prescaler, uint8 quanta,
+                         uint16 samplePoint, can_bitTiming* timingPtr)
+{
+    uint64 tqClocks=(uint64)prescaler*1000000000;
+    sint32 propSeg, phaseSeg1, phaseSeg2, sjw;
+    uint32 tolerance1, tolerance2;
+
+    //quanta needed to cover the round trip delay, rounded up
+    propSeg=(sint32)(((uint64)requestPtr->propDelay*requestPtr->Fsys + tqClocks-1)/tqClocks);
+    if (propSeg < 1)
+    {
+        propSeg=1;
+    }
+    phaseSeg2=quanta - ((uint32)samplePoint*quanta + 500)/1000;
+    if (phaseSeg2 < CAN_TSEG2_MIN)
+    {
+        phaseSeg2=CAN_TSEG2_MIN;
+    }
+    if (phaseSeg2 > CAN_TSEG2_MAX)
+    {
+        phaseSeg2=CAN_TSEG2_MAX;
+    }
+    phaseSeg1=quanta-1-propSeg-phaseSeg2;
+    if (phaseSeg1 < 1) //sample later to make room for the delay
+    {
+        phaseSeg1=1;
+        phaseSeg2=quanta-2-propSeg;
+    }
+    if (propSeg+phaseSeg1 > CAN_TSEG1_MAX) //sample earlier, TSEG1 is full
+    {
+        phaseSeg1=CAN_TSEG1_MAX-propSeg;
+        phaseSeg2=quanta-1-CAN_TSEG1_MAX;
+    }
+    if (phaseSeg1 < 1 || phaseSeg2 < CAN_TSEG2_MIN || phaseSeg2 > CAN_TSEG2_MAX)
+    {
+        return FALSE;
+    }
+    sjw=CAN_SJW_MAX;
+    if (sjw > phaseSeg1)
+    {
+        sjw=phaseSeg1;
+    }
+    if (sjw > phaseSeg2)
+    {
+        sjw=phaseSeg2;
+    }
+    //oscillator tolerance conditions of the CAN specification
+    tolerance1=(uint32)sjw*1000000/(20*quanta);
+    tolerance2=(uint32)(phaseSeg1 < phaseSeg2 ? phaseSeg1 : phaseSeg2)*1000000/(2*(13*quanta-phaseSeg2));
+
+    timingPtr->prescaler=prescaler;
+    timingPtr->quanta=quanta;
+    timingPtr->propSeg=propSeg;
+    timingPtr->phaseSeg1=phaseSeg1;
+    timingPtr->phaseSeg2=phaseSeg2;
+    timingPtr->sjw=sjw;
+    timingPtr->samplePoint=(uint16)((1+propSeg+phaseSeg1)*1000/quanta);
+    timingPtr->bitRate=requestPtr->Fsys/(prescaler*quanta);
+    timingPtr->tolerance=tolerance1 < tolerance2 ? tolerance1 : tolerance2;
+    timingPtr->BIT=((prescaler-1) & 0x3F) << CAN_BIT_BRP_S |
+            (uint32)(sjw-1) << CAN_BIT_SJW_S |
+            (uint32)(propSeg+phaseSeg1-1) << CAN_BIT_TSEG1_S |
+            (uint32)(phaseSeg2-1) << CAN_BIT_TSEG2_S;
+    timingPtr->BRPE=((prescaler-1)>>6) & CAN_BRPE_BRPE_M;
+    return TRUE;
+}
+/*
+ * Description : ranking, closest sample point first, then the widest
+ *               oscillator tolerance, then the finest quanta
+ */
+static bool can_timingBetter(const can_bitTiming* a, const can_bitTiming* b, uint16 samplePoint)
+{
+    uint32 errorA=can_absDiff(a->samplePoint, samplePoint);
+    uint32 errorB=can_absDiff(b->samplePoint, samplePoint);
+
+    if (errorA != errorB)
+    {
+        return errorA < errorB;
+    }
+    if (a->tolerance != b->tolerance)
+    {
+        return a->tolerance > b->tolerance;
+    }
+    return a->quanta > b->quanta;
+}
+/*******************************************************************************
+ *                      Functions Definitions                                  *
+ *******************************************************************************/
+/*
+ * Description : Function to search the bit timing settings of a bit rate.
+ *  Every quanta count from 4 to 25 (or only requestPtr->quanta) is tried with
+ *  the prescaler (1..1024) that gives the closest bit rate; only the settings
+ *  with the smallest bit rate error are kept. Each one is split into
+ *  sync + propagation + phase1 + phase2 so that the propagation segment
+ *  covers propDelay and the sample point is as close as possible to the
+ *  wanted one, with SJW as large as the phases allow.
+ *  Settings are ranked by sample point error, then oscillator tolerance.
+ *
+ *  Arguments: pointer to the clock, bit rate, delay and sample point,
+ *             pointer to the result filled with up to
+ *             CAN_BIT_TIMING_CANDIDATES settings, the best one first
+ *  Returns: FALSE if no legal setting exists
+ */
+bool can_computeBitTiming(const can_bitTimingRequest* requestPtr, can_bitTimingResult* resultPtr)
+{
+    CAN_PROFILE_FUNCTION(can_computeBitTiming);
+    uint16 samplePoint=requestPtr->samplePoint ? requestPtr->samplePoint : CAN_SAMPLE_POINT_DEFAULT;
+    uint8 first=CAN_QUANTA_MIN, last=CAN_QUANTA_MAX, quanta, i;
+    uint32 prescaler, bestError=0xFFFFFFFF;
+    can_bitTiming candidate;
+
+    resultPtr->count=0;
+    if (requestPtr->Fsys == 0 || requestPtr->bitRate == 0)
+    {
+        return FALSE;
+    }
+    if (requestPtr->quanta != 0)
+    {
+        if (requestPtr->quanta < CAN_QUANTA_MIN || requestPtr->quanta > CAN_QUANTA_MAX)
+        {
+            return FALSE;
+        }
+        first=last=requestPtr->quanta;
+    }
+    //smallest bit rate error any quanta count can reach
+    for (quanta=first; quanta<=last; quanta++)
+    {
+        prescaler=can_prescalerFor(requestPtr, quanta);
+        if (prescaler != 0 && can_rateError(requestPtr, prescaler, quanta) < bestError)
+        {
+            bestError=can_rateError(requestPtr, prescaler, quanta);
+        }
+    }
+    for (quanta=first; quanta<=last; quanta++)
+    {
+        prescaler=can_prescalerFor(requestPtr, quanta);
+        if (prescaler == 0 || can_rateError(requestPtr, prescaler, quanta) != bestError ||
+                !can_splitBit(requestPtr, prescaler, quanta, samplePoint, &candidate))
+        {
+            continue;
+        }
+        //insertion into the ranked list
+        i=resultPtr->count;
+        if (i == CAN_BIT_TIMING_CANDIDATES)
+        {
+            if (!can_timingBetter(&candidate, &resultPtr->timing[i-1], samplePoint))
+            {
+                continue;
+            }
+            i--;
+        }
+        else
+        {
+            resultPtr->count++;
+        }
+        while (i > 0 && can_timingBetter(&candidate, &resultPtr->timing[i-1], samplePoint))
+        {
+            resultPtr->timing[i]=resultPtr->timing[i-1];
+            i--;
+        }
+        resultPtr->timing[i]=candidate;
+    }
+    return resultPtr->count > 0;
+}
+#endif /* CAN_BIT_TIMING_SOLVER */
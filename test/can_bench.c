@@ -0,0 +1,192 @@
+/*
+ * File name: can_bench.c
+ *
+ *  Host benchmark of the driver on the register level model: calls of
+ *  can_transmit() (against its compile-time instance), can_updateMessage()
+ *  and can_receive(), frames put on the
+ *  bus and frames through the receive path (external node to
+ *  can_readFrame()) and the transmit path (can_transmitAsync() to the
+ *  completion interrupt) per second of wall clock time, built with
+ *  CAN_HOST_SIM (see Makefile)
+ */
+#include <stdio.h>
+#include <time.h>
+#include "can.h"
+/*******************************************************************************
+ *                         Definitions                                         *
+ *******************************************************************************/
+#define BENCH_CALLS     1000000
+#define BENCH_BURST     16      //frames put on the bus between two reads
+CAN_DEFINE_INSTANCE(CAN0)
+/*******************************************************************************
+ *                      Private Functions                                      *
+ *******************************************************************************/
+static uint64 bench_nowNs(void)
+{
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64)now.tv_sec*1000000000ULL+now.tv_nsec;
+}
+static void bench_report(const char* name, uint32 count, uint64 ns)
+{
+    printf("%-22s %9lu %8.3f s %10.0f per s\n", name, (unsigned long)count,
+           (double)ns/1e9, (double)count*1e9/(double)ns);
+}
+/*
+ * Description : the register sequences of the driver functions on the model
+ */
+static void bench_calls(void)
+{
+    can_transmitStruct transmit={0};
+    can_updateStruct update={0};
+    can_receiveStruct receive={0};
+    uint32 i;
+    uint64 start;
+
+    can_sim_reset(80000000);
+    transmit.module=module0;
+    transmit.ID=0x123;
+    transmit.ID_mask=0x7FF;
+    transmit.bytesNum=8;
+    transmit.messageNum=1;
+    start=bench_nowNs();
+    for (i=0; i<BENCH_CALLS; i++)
+    {
+        transmit.Data=i;
+        can_transmit(&transmit);
+    }
+    bench_report("can_transmit", BENCH_CALLS, bench_nowNs()-start);
+    start=bench_nowNs();
+    for (i=0; i<BENCH_CALLS; i++)
+    {
+        transmit.Data=i;
+        can_transmit_CAN0(&transmit);
+    }
+    bench_report("can_transmit_CAN0", BENCH_CALLS, bench_nowNs()-start);
+
+    update.module=module0;
+    update.bytesNum=8;
+    update.messageNum=1;
+    start=bench_nowNs();
+    for (i=0; i<BENCH_CALLS; i++)
+    {
+        update.Data=i;
+        can_updateMessage(&update);
+    }
+    bench_report("can_updateMessage", BENCH_CALLS, bench_nowNs()-start);
+
+    receive.module=module1;
+    receive.ID=0x123;
+    receive.ID_mask=0x7FF;
+    receive.bytesNum=8;
+    receive.messageNum=2;
+    start=bench_nowNs();
+    for (i=0; i<BENCH_CALLS; i++)
+    {
+        can_receive(&receive);
+    }
+    bench_report("can_receive", BENCH_CALLS, bench_nowNs()-start);
+}
+/*
+ * Description : frames of the external node received by a CAN1 object
+ */
+static void bench_bus(void)
+{
+    can_simFrame frame={0};
+    uint32 i;
+    uint64 start;
+
+    can_sim_reset(80000000);
+    *can_sim_reg(0x40041000)=0; //CAN1 out of the initialization state
+    *can_sim_reg(0x40041084)=0xF3; //IF2 CMSK: WRNRD, MASK, ARB, CONTROL, DATAA/B
+    *can_sim_reg(0x4004108C)=0;
+    *can_sim_reg(0x40041094)=0x8000 | 0x100<<2; //MSGVAL, id 0x100
+    *can_sim_reg(0x40041098)=0x1088; //UMASK, EOB, 8 bytes
+    *can_sim_reg(0x40041080)=1;
+    frame.dlc=8;
+    start=bench_nowNs();
+    for (i=0; i<BENCH_CALLS; i++)
+    {
+        frame.ID=0x100+(i & 0xFF);
+        can_sim_inject(&frame);
+        can_sim_busStep();
+    }
+    bench_report("bus frames", BENCH_CALLS, bench_nowNs()-start);
+}
+/*
+ * Description : frames of the external node drained by the ISR of CAN1 and
+ *               read back
+ */
+static void bench_receive(void)
+{
+    can_receiveStruct receive={0};
+    can_simFrame frame={0};
+    can_frame received;
+    uint32 sent, read=0, i;
+    uint64 start;
+
+    can_sim_reset(80000000);
+    can_sim_setIsr(1, CAN1_Handler);
+    *can_sim_reg(0x40041000)=0x06; //CAN1 on the bus with IE and SIE
+    receive.module=module1;
+    receive.ID=0x100;
+    receive.ID_mask=0x700;
+    receive.bytesNum=8;
+    receive.messageNum=8;
+    can_configureReceive(&receive);
+    frame.dlc=8;
+    start=bench_nowNs();
+    for (sent=0; sent<BENCH_CALLS; sent +=BENCH_BURST)
+    {
+        for (i=0; i<BENCH_BURST; i++)
+        {
+            frame.ID=0x100+(i & 0xFF);
+            frame.data[0]=(uint8)i;
+            can_sim_inject(&frame);
+            can_sim_busStep();
+        }
+        while (can_readFrame(module1, &received))
+        {
+            read++;
+        }
+    }
+    bench_report("receive", read, bench_nowNs()-start);
+}
+/*
+ * Description : frames queued on CAN0 until their completion interrupt
+ */
+static void bench_transmit(void)
+{
+    can_transmitStruct transmit={0};
+    uint32 sent, i;
+    uint64 start;
+
+    can_sim_reset(80000000);
+    can_sim_setIsr(0, CAN0_Handler);
+    *can_sim_reg(0x40040000)=0x06; //CAN0 on the bus with IE and SIE
+    transmit.module=module0;
+    transmit.bytesNum=8;
+    start=bench_nowNs();
+    for (sent=0; sent<BENCH_CALLS; sent +=BENCH_BURST)
+    {
+        for (i=0; i<BENCH_BURST; i++)
+        {
+            transmit.ID=0x100+i;
+            can_transmitAsync(&transmit);
+        }
+        can_sim_runBus(BENCH_BURST);
+    }
+    bench_report("transmit", sent, bench_nowNs()-start);
+}
+/*******************************************************************************
+ *                      Functions Definitions                                  *
+ *******************************************************************************/
+int main(void)
+{
+    bench_calls();
+    bench_bus();
+    bench_receive();
+    bench_transmit();
+    return 0;
+}
@@ -0,0 +1,1604 @@
+/*
+ * File name: can_test.c
+ *
+ *  Host regression tests of the driver on the register level model (built
+ *  with CAN_HOST_SIM, see Makefile). Every scenario starts from a reset
+ *  model; the exit status is 1 when a check failed.
+ */
+#include <stdio.h>
+#include <string.h>
+#include "can.h"
+/*******************************************************************************
+ *                         Definitions                                         *
+ *******************************************************************************/
+#define CHECK(condition) \
+    do { if (!(condition)) { printf("FAIL %s:%d %s\n", __FILE__, __LINE__, #condition); test_fails++; } } while (0)
+//functions that only count their calls, distinct for the handler slot test
+#define TEST_HANDLER(n) \
+    static void test_handler##n(can_Module module, const can_frame* framePtr) \
+    { (void)module; (void)framePtr; test_calls[n]++; }
+//register of a module by its offset, IF1 at 0x20 and IF2 at 0x80
+#define TEST_REG(module, offset)    (*can_sim_reg(0x40040000+(module)*0x1000+(offset)))
+#define TEST_IF(module, ifn, offset) TEST_REG(module, ((ifn) == 1 ? 0x20 : 0x80)+(offset))
+#define CAN_TX_OBJECT_RANGE_TEST    ((uint32)CAN_OBJECT_RANGE(CAN_TX_FIRST_OBJECT, CAN_TX_OBJECTS))
+CAN_DEFINE_INSTANCE(CAN0)
+CAN_DEFINE_INSTANCE(CAN1)
+/*******************************************************************************
+ *                         Global Variables                                    *
+ *******************************************************************************/
+static int test_fails;
+static uint32 test_calls[40];
+static uint32 test_txDone;
+static uint32 test_lastSentId;
+static uint32 test_statusCalls;
+static uint32 test_lastStatus;
+TEST_HANDLER(0) TEST_HANDLER(1) TEST_HANDLER(2) TEST_HANDLER(3) TEST_HANDLER(4) TEST_HANDLER(5) TEST_HANDLER(6)
+TEST_HANDLER(7) TEST_HANDLER(8) TEST_HANDLER(9) TEST_HANDLER(10) TEST_HANDLER(11) TEST_HANDLER(12) TEST_HANDLER(13)
+TEST_HANDLER(14) TEST_HANDLER(15) TEST_HANDLER(16) TEST_HANDLER(17) TEST_HANDLER(18) TEST_HANDLER(19) TEST_HANDLER(20)
+TEST_HANDLER(21) TEST_HANDLER(22) TEST_HANDLER(23) TEST_HANDLER(24) TEST_HANDLER(25) TEST_HANDLER(26) TEST_HANDLER(27)
+TEST_HANDLER(28) TEST_HANDLER(29) TEST_HANDLER(30) TEST_HANDLER(31) TEST_HANDLER(32) TEST_HANDLER(33) TEST_HANDLER(34)
+TEST_HANDLER(35) TEST_HANDLER(36) TEST_HANDLER(37) TEST_HANDLER(38) TEST_HANDLER(39)
+static const can_rxHandler test_handlers[40] = {
+    test_handler0, test_handler1, test_handler2, test_handler3, test_handler4, test_handler5, test_handler6,
+    test_handler7, test_handler8, test_handler9, test_handler10, test_handler11, test_handler12, test_handler13,
+    test_handler14, test_handler15, test_handler16, test_handler17, test_handler18, test_handler19, test_handler20,
+    test_handler21, test_handler22, test_handler23, test_handler24, test_handler25, test_handler26, test_handler27,
+    test_handler28, test_handler29, test_handler30, test_handler31, test_handler32, test_handler33, test_handler34,
+    test_handler35, test_handler36, test_handler37, test_handler38, test_handler39
+};
+/*******************************************************************************
+ *                      Private Functions                                      *
+ *******************************************************************************/
+static void test_txCallback(can_Module module, const can_frame* framePtr)
+{
+    (void)module;
+    test_txDone++;
+    test_lastSentId=framePtr->ID;
+}
+static void test_statusCallback(can_Module module, uint32 status)
+{
+    (void)module;
+    test_statusCalls++;
+    test_lastStatus=status;
+}
+/*
+ * Description : CAN_RX_TIMESTAMP() of the test builds, see can_test_clock.h
+ */
+uint64 test_clock(void)
+{
+    static uint64 busTime, last;
+    uint64 now=can_sim_getTimeNs();
+
+    if (now != busTime)
+    {
+        busTime=now;
+        last=now;
+        return last;
+    }
+    return ++last;
+}
+/*
+ * Description : payload of a frame with data[0] in the least significant byte
+ */
+static uint64 test_frameData(const can_frame* framePtr)
+{
+    uint64 data=0;
+    sint8 i;
+
+    for (i=7; i>=0; i--)
+    {
+        data=data<<8 | framePtr->data[i];
+    }
+    return data;
+}
+/*
+ * Description : writes a whole message object through one interface of
+ *               the model, standard id, the mask used (UMASK) when given
+ */
+static void test_writeObject(uint8 module, uint8 ifn, uint8 num, uint32 ID, uint32 mask, uint16 arb2Bits,
+                             uint16 mctl, const uint8* data)
+{
+    TEST_IF(module, ifn, 0x04)=0xF3 | ((mctl & 0x0100) ? 0x04 : 0); //WRNRD, MASK, ARB, CONTROL, DATAA/B (TXRQST)
+    TEST_IF(module, ifn, 0x08)=0;
+    TEST_IF(module, ifn, 0x0C)=(mask & 0x7FF)<<2;
+    TEST_IF(module, ifn, 0x10)=0;
+    TEST_IF(module, ifn, 0x14)=arb2Bits | (ID & 0x7FF)<<2;
+    TEST_IF(module, ifn, 0x18)=mctl & ~0x0100;
+    TEST_IF(module, ifn, 0x1C)=data ? data[0] | data[1]<<8 : 0;
+    TEST_IF(module, ifn, 0x20)=data ? data[2] | data[3]<<8 : 0;
+    TEST_IF(module, ifn, 0x24)=data ? data[4] | data[5]<<8 : 0;
+    TEST_IF(module, ifn, 0x28)=data ? data[6] | data[7]<<8 : 0;
+    TEST_IF(module, ifn, 0x00)=num;
+}
+/*
+ * Description : reads a message object back and clears NEWDAT/INTPND
+ */
+static void test_readObject(uint8 module, uint8 ifn, uint8 num, uint16* arb2Ptr, uint16* mctlPtr, uint8* data)
+{
+    uint32 da1, da2, db1, db2;
+
+    TEST_IF(module, ifn, 0x04)=0x3F; //ARB, CONTROL, CLRINTPND, NEWDAT, DATAA/B
+    TEST_IF(module, ifn, 0x00)=num;
+    *arb2Ptr=TEST_IF(module, ifn, 0x14);
+    *mctlPtr=TEST_IF(module, ifn, 0x18);
+    da1=TEST_IF(module, ifn, 0x1C);
+    da2=TEST_IF(module, ifn, 0x20);
+    db1=TEST_IF(module, ifn, 0x24);
+    db2=TEST_IF(module, ifn, 0x28);
+    data[0]=da1; data[1]=da1>>8; data[2]=da2; data[3]=da2>>8;
+    data[4]=db1; data[5]=db1>>8; data[6]=db2; data[7]=db2>>8;
+}
+static void test_receiveStruct(can_receiveStruct* receivePtr, uint32 ID, uint32 mask)
+{
+    memset(receivePtr, 0, sizeof(*receivePtr));
+    receivePtr->module=module1;
+    receivePtr->ID=ID;
+    receivePtr->ID_mask=mask;
+    receivePtr->bytesNum=8;
+}
+static void test_modelSetup(void)
+{
+    can_simFrame log;
+
+    can_sim_reset(16000000);
+    TEST_REG(0, 0x00)=0; //leave the initialization state
+    TEST_REG(1, 0x00)=0;
+    while (can_sim_readBusLog(&log));
+}
+static void test_setup(void)
+{
+    can_configStruct config={0};
+    can_frame frame;
+
+    test_modelSetup();
+    can_sim_setIsr(0, CAN0_Handler);
+    can_sim_setIsr(1, CAN1_Handler);
+    config.clock=clock16MHz;
+    config.rate=bitRate500k;
+    config.module=module0;
+    CHECK(can_init(&config));
+    config.module=module1;
+    CHECK(can_init(&config));
+    while (can_readFrame(module0, &frame));
+    while (can_readFrame(module1, &frame));
+}
+/*
+ * Description : a transmit object of CAN0 to a receive object of CAN1
+ *               through both interfaces, and the bitmaps on the way
+ */
+static void test_modelTransfer(void)
+{
+    const uint8 data[8]={1, 2, 3, 4, 5, 6, 7, 8};
+    uint8 read[8];
+    uint16 arb2, mctl;
+    can_simFrame log;
+
+    test_modelSetup();
+    test_writeObject(1, 2, 2, 0x123, 0x7FF, 0x8000, 0x1083, 0);    //MSGVAL, UMASK, EOB, 3 bytes
+    test_writeObject(0, 1, 1, 0x123, 0x7FF, 0xA000, 0x0183, data); //MSGVAL, DIR, TXRQST, EOB
+    CHECK(TEST_REG(0, 0x100) == 0x0001 && TEST_REG(0, 0x160) == 0x0001);
+    CHECK(TEST_REG(1, 0x160) == 0x0002 && TEST_REG(1, 0x120) == 0);
+    CHECK(can_sim_runBus(10) == 1);
+    CHECK(TEST_REG(0, 0x100) == 0 && TEST_REG(1, 0x120) == 0x0002);
+    CHECK(can_sim_readBusLog(&log) && log.ID == 0x123 && log.dlc == 3 && !log.remote && log.source == 0);
+    CHECK(log.data[0] == 1 && log.data[2] == 3 && log.timeNs > 0 && log.timeNs == can_sim_getTimeNs());
+    test_readObject(1, 1, 2, &arb2, &mctl, read);
+    CHECK((mctl & 0x8000) && (mctl & 0x000F) == 3 && ((arb2>>2) & 0x7FF) == 0x123);
+    CHECK(read[0] == 1 && read[1] == 2 && read[2] == 3);
+    CHECK(TEST_REG(1, 0x120) == 0);
+
+    //a second frame before the first is read sets MSGLST
+    TEST_IF(0, 2, 0x04)=0x84; //WRNRD, TXRQST
+    TEST_IF(0, 2, 0x00)=1;
+    CHECK(can_sim_runBus(10) == 1);
+    TEST_IF(0, 2, 0x00)=1;
+    CHECK(can_sim_runBus(10) == 1);
+    test_readObject(1, 2, 2, &arb2, &mctl, read);
+    CHECK((mctl & 0x4000) && can_sim_getFrameCount() == 3);
+}
+/*
+ * Description : lowest arbitration field first between CAN0, CAN1 and the
+ *               external node, remote frames answered by RMTEN objects
+ */
+static void test_modelArbitration(void)
+{
+    can_simFrame frame={0}, log;
+    uint16 arb2, mctl;
+    uint8 read[8];
+
+    test_modelSetup();
+    test_writeObject(0, 1, 1, 0x300, 0x7FF, 0xA000, 0x0181, 0);
+    test_writeObject(1, 1, 1, 0x100, 0x7FF, 0xA000, 0x0181, 0);
+    frame.ID=0x200;
+    CHECK(can_sim_inject(&frame));
+    CHECK(can_sim_runBus(10) == 3);
+    CHECK(can_sim_readBusLog(&log) && log.ID == 0x100 && log.source == 1);
+    CHECK(can_sim_readBusLog(&log) && log.ID == 0x200 && log.source == CAN_SIM_EXTERNAL_NODE);
+    CHECK(can_sim_readBusLog(&log) && log.ID == 0x300 && log.source == 0);
+    CHECK(!can_sim_readBusLog(&log));
+
+    test_writeObject(0, 1, 3, 0x400, 0x7FF, 0xA000, 0x1281, 0);   //RMTEN
+    test_writeObject(1, 1, 3, 0x400, 0x7FF, 0x8000, 0x1181, 0);   //receive object with TXRQST asks
+    CHECK(can_sim_runBus(10) == 2);
+    CHECK(can_sim_readBusLog(&log) && log.remote && log.ID == 0x400 && log.source == 1);
+    CHECK(can_sim_readBusLog(&log) && !log.remote && log.ID == 0x400 && log.source == 0);
+    test_readObject(1, 1, 3, &arb2, &mctl, read);
+    CHECK(mctl & 0x8000);
+}
+/*
+ * Description : a frame kept in the next member of a chain (EOB clear)
+ *               while the first one still holds new data
+ */
+static void test_modelFifo(void)
+{
+    can_simFrame frame={0};
+    uint16 arb2, mctl;
+    uint8 read[8];
+
+    test_modelSetup();
+    test_writeObject(1, 1, 5, 0x10, 0x7F0, 0x8000, 0x1001, 0);
+    test_writeObject(1, 1, 6, 0x10, 0x7F0, 0x8000, 0x1081, 0);
+    frame.dlc=1;
+    frame.ID=0x11;
+    frame.data[0]=0xA1;
+    can_sim_inject(&frame);
+    frame.ID=0x12;
+    frame.data[0]=0xA2;
+    can_sim_inject(&frame);
+    CHECK(can_sim_runBus(10) == 2);
+    CHECK(TEST_REG(1, 0x120) == 0x0030);
+    test_readObject(1, 1, 5, &arb2, &mctl, read);
+    CHECK(((arb2>>2) & 0x7FF) == 0x11 && read[0] == 0xA1);
+    test_readObject(1, 1, 6, &arb2, &mctl, read);
+    CHECK(((arb2>>2) & 0x7FF) == 0x12 && read[0] == 0xA2 && !(mctl & 0x4000));
+}
+/*
+ * Description : frames drained by the ISR into the ring in arrival order,
+ *               a full ring and a frame overwritten in its object
+ */
+static void test_receive(void)
+{
+    can_receiveStruct receive;
+    can_simFrame frame={0};
+    can_frame received;
+    uint32 i, overflows;
+    uint64 last=0;
+
+    test_setup();
+    test_receiveStruct(&receive, 0x120, 0x7F0);
+    receive.messageNum=8;
+    can_configureReceive(&receive);
+    test_receiveStruct(&receive, 0x1ABCDE, 0x1FFFFFFF);
+    receive.ID_type=extended;
+    receive.messageNum=9;
+    can_configureReceive(&receive);
+    frame.dlc=8;
+    for (i=0; i<3; i++)
+    {
+        frame.ID=0x120+i;
+        frame.data[0]=i;
+        frame.data[7]=0x80+i;
+        can_sim_inject(&frame);
+    }
+    frame.extended=TRUE;
+    frame.ID=0x1ABCDE;
+    can_sim_inject(&frame);
+    frame.ID=0x1ABCDF;
+    can_sim_inject(&frame);
+    CHECK(can_sim_runBus(10) == 5);
+    CHECK(can_rxPending(module1) == 4 && can_rxPending(module0) == 0);
+    for (i=0; i<3; i++)
+    {
+        CHECK(can_readFrame(module1, &received));
+        CHECK(received.ID == 0x120+i && !(received.flags & CAN_FRAME_EXTENDED) && received.dlc == 8 && received.messageNum == 8);
+        CHECK(test_frameData(&received) == ((0x80ULL+i)<<56 | i) && !(received.flags & CAN_FRAME_LOST) && received.timestamp >= last);
+        last=received.timestamp;
+    }
+    CHECK(can_readFrame(module1, &received) && received.ID == 0x1ABCDE && (received.flags & CAN_FRAME_EXTENDED));
+    CHECK(!can_readFrame(module1, &received));
+
+    overflows=can_rxOverflows(module1);
+    frame.extended=FALSE;
+    frame.ID=0x121;
+    for (i=0; i<CAN_RX_RING_SIZE+5; i++)
+    {
+        can_sim_inject(&frame);
+        can_sim_busStep();
+    }
+    CHECK(can_rxPending(module1) == CAN_RX_RING_SIZE && can_rxOverflows(module1) == overflows+5);
+    while (can_readFrame(module1, &received));
+
+    TEST_REG(1, 0x00)=0x04; //IE off, the next frames overwrite the first
+    can_sim_inject(&frame);
+    can_sim_runBus(10);
+    TEST_REG(1, 0x00)=0x06;
+    frame.ID=0x122;
+    can_sim_inject(&frame);
+    can_sim_runBus(10);
+    CHECK(can_readFrame(module1, &received) && received.ID == 0x122 && (received.flags & CAN_FRAME_LOST));
+    CHECK(!can_readFrame(module1, &received));
+}
+/*
+ * Description : frames waiting in the transmit queue sent in id order, the
+ *               callback of each, a full queue refused
+ */
+static void test_transmitAsync(void)
+{
+    const uint32 ids[7]={0x700, 0x701, 0x702, 0x703, 0x300, 0x100, 0x200};
+    can_transmitStruct transmit={0};
+    can_simFrame log;
+    uint32 i, state;
+
+    test_setup();
+    test_txDone=0;
+    can_setTxCallback(module0, test_txCallback);
+    transmit.module=module0;
+    transmit.bytesNum=2;
+    state=can_sim_enterCritical();
+    for (i=0; i<7; i++)
+    {
+        transmit.ID=ids[i];
+        transmit.Data=i;
+        CHECK(can_transmitAsync(&transmit));
+    }
+    CHECK(can_txQueued(module0) == 7 && can_txQueued(module1) == 0);
+    can_sim_exitCritical(state);
+    CHECK(can_sim_runBus(20) == 7);
+    //the queued frames take object 1 below 0x701..0x703 once 0x700 is sent
+    CHECK(can_sim_readBusLog(&log) && log.ID == 0x700 && log.data[0] == 0);
+    CHECK(can_sim_readBusLog(&log) && log.ID == 0x100 && log.data[0] == 5);
+    CHECK(can_sim_readBusLog(&log) && log.ID == 0x200);
+    CHECK(can_sim_readBusLog(&log) && log.ID == 0x300);
+    for (i=1; i<4; i++)
+    {
+        CHECK(can_sim_readBusLog(&log) && log.ID == 0x700+i && log.data[0] == i);
+    }
+    CHECK(test_txDone == 0); //the callback runs from can_process()
+    can_process(0);
+    CHECK(test_txDone == 7 && test_lastSentId == 0x703 && can_txQueued(module0) == 0);
+
+    //an urgent frame goes into a free object below the busy ones it beats,
+    //frames of lower priority into one above those they lose to
+    transmit.ID=0x300;
+    CHECK(can_transmitAsync(&transmit));
+    transmit.ID=0x301;
+    CHECK(can_transmitAsync(&transmit));
+    CHECK(can_sim_busStep() && can_sim_readBusLog(&log) && log.ID == 0x300);
+    transmit.ID=0x302;
+    CHECK(can_transmitAsync(&transmit));
+    transmit.ID=0x010;
+    CHECK(can_transmitAsync(&transmit));
+    CHECK(can_txQueued(module0) == 3 && can_sim_runBus(10) == 3);
+    CHECK(can_sim_readBusLog(&log) && log.ID == 0x010);
+    CHECK(can_sim_readBusLog(&log) && log.ID == 0x301);
+    CHECK(can_sim_readBusLog(&log) && log.ID == 0x302);
+    can_process(0);
+
+    TEST_REG(0, 0x00)=0x07; //INIT, nothing leaves
+    for (i=0; i<CAN_TX_QUEUE_SIZE+CAN_TX_OBJECTS; i++)
+    {
+        CHECK(can_transmitAsync(&transmit));
+    }
+    CHECK(!can_transmitAsync(&transmit));
+    TEST_REG(0, 0x00)=0x06;
+    can_sim_runBus(100);
+    CHECK(can_txQueued(module0) == 0);
+    can_setTxCallback(module0, 0);
+}
+/*
+ * Description : the compile-time instances and can_transmit() or
+ *               can_updateMessage() built from them, each frame received
+ */
+static void test_instance(void)
+{
+    can_receiveStruct receive;
+    can_transmitStruct transmit={0};
+    can_updateStruct update={0};
+    can_frame received;
+
+    test_setup();
+    test_receiveStruct(&receive, 0x240, 0x7F0);
+    receive.messageNum=10;
+    can_configureReceive(&receive);
+    transmit.module=module0;
+    transmit.ID=0x241;
+    transmit.ID_mask=0x7FF;
+    transmit.bytesNum=8;
+    transmit.Data=0x0807060504030201ULL;
+    transmit.messageNum=12;
+    CHECK(can_transmit_CAN0(&transmit));
+    can_sim_runBus(10);
+    CHECK(can_readFrame(module1, &received) && received.ID == 0x241 && test_frameData(&received) == transmit.Data);
+    update.bytesNum=8;
+    update.Data=0x1122334455667788ULL;
+    update.messageNum=12;
+    CHECK(can_updateMessage_CAN0(&update));
+    can_sim_runBus(10);
+    CHECK(can_readFrame(module1, &received) && received.ID == 0x241 && test_frameData(&received) == update.Data);
+
+    transmit.ID=0x242;
+    CHECK(can_transmit(&transmit));
+    can_sim_runBus(10);
+    CHECK(can_readFrame(module1, &received) && received.ID == 0x242 && test_frameData(&received) == 0x0807060504030201ULL);
+    update.module=module0;
+    update.Data=0xAA;
+    CHECK(can_updateMessage(&update));
+    can_sim_runBus(10);
+    CHECK(can_readFrame(module1, &received) && received.ID == 0x242 && test_frameData(&received) == 0xAA);
+
+    //CAN1 to the receive object of CAN0
+    receive.module=module0;
+    receive.messageNum=10;
+    can_configureReceive(&receive);
+    transmit.ID=0x243;
+    CHECK(can_transmit_CAN1(&transmit));
+    can_sim_runBus(10);
+    CHECK(can_readFrame(module0, &received) && received.ID == 0x243);
+    CHECK(!can_readFrame(module1, &received));
+}
+/*
+ * Description : the register map on the addresses of the register names,
+ *               a remote frame type of CAN1 answered by CAN1 itself
+ */
+static void test_registerMap(void)
+{
+    can_transmitStruct transmit={0};
+    can_simFrame request={0}, log;
+    uint16 arb2, mctl;
+    uint8 read[8];
+
+    test_setup();
+    CHECK(&CAN_REGS(module0)->CTL == can_sim_reg(0x40040000));
+    CHECK(&CAN_REGS(module1)->IF[0].CRQ == can_sim_reg(0x40041020));
+    CHECK(&CAN_REGS(module1)->IF[1].DB2 == can_sim_reg(0x400410A8));
+    CHECK(&CAN_REGS(module0)->TXRQ[1] == can_sim_reg(0x40040104));
+    CHECK(&CAN_REGS(module1)->MSGVAL[1] == can_sim_reg(0x40041164));
+
+    transmit.module=module1;
+    transmit.frameType=remote;
+    transmit.ID=0x450;
+    transmit.ID_mask=0x7FF;
+    transmit.bytesNum=1;
+    transmit.Data=0x5A;
+    transmit.messageNum=12;
+    CHECK(can_transmit(&transmit));
+    CHECK(can_sim_runBus(10) == 1);
+    test_readObject(0, 1, 12, &arb2, &mctl, read);
+    CHECK(!(arb2 & 0x8000) && !(mctl & 0x0200)); //nothing written to CAN0
+    request.ID=0x450;
+    request.remote=TRUE;
+    can_sim_inject(&request);
+    CHECK(can_sim_runBus(10) == 2);
+    CHECK(can_sim_readBusLog(&log) && log.ID == 0x450 && log.source == 1);
+    CHECK(can_sim_readBusLog(&log) && log.remote && log.source == CAN_SIM_EXTERNAL_NODE);
+    CHECK(can_sim_readBusLog(&log) && !log.remote && log.source == 1 && log.data[0] == 0x5A);
+}
+/*
+ * Description : a setting of can_computeBitTiming() against its own fields
+ *               and its CANBIT/CANBRPE values
+ */
+static void test_checkTiming(const can_bitTimingRequest* requestPtr, const can_bitTiming* timingPtr)
+{
+    uint32 brp=((timingPtr->BRPE & 0xF)<<6 | (timingPtr->BIT & 0x3F))+1;
+    uint32 tseg1=((timingPtr->BIT>>8) & 0xF)+1, tseg2=((timingPtr->BIT>>12) & 0x7)+1;
+
+    CHECK(brp == timingPtr->prescaler && ((timingPtr->BIT>>6) & 0x3)+1 == timingPtr->sjw);
+    CHECK(tseg1 == (uint32)timingPtr->propSeg+timingPtr->phaseSeg1 && tseg2 == timingPtr->phaseSeg2);
+    CHECK(1+tseg1+tseg2 == timingPtr->quanta && timingPtr->quanta >= 4 && timingPtr->quanta <= 25);
+    CHECK(timingPtr->phaseSeg2 >= 2 && timingPtr->sjw <= timingPtr->phaseSeg1 && timingPtr->sjw <= timingPtr->phaseSeg2);
+    CHECK(timingPtr->bitRate == requestPtr->Fsys/(timingPtr->prescaler*timingPtr->quanta));
+    CHECK(timingPtr->samplePoint == (1+tseg1)*1000/timingPtr->quanta);
+    CHECK((uint64)timingPtr->propSeg*timingPtr->prescaler*1000000000ULL >= (uint64)requestPtr->propDelay*requestPtr->Fsys);
+}
+/*
+ * Description : exact settings of common clocks ranked by sample point
+ *               error, the quanta count forced, impossible requests refused
+ */
+static void test_bitTiming(void)
+{
+    can_bitTimingRequest request={0};
+    can_bitTimingResult result;
+    uint32 i;
+
+    request.Fsys=16000000;
+    request.bitRate=500000;
+    CHECK(can_computeBitTiming(&request, &result) && result.count > 1);
+    CHECK(result.timing[0].bitRate == 500000 && result.timing[0].samplePoint == 875);
+    for (i=0; i<result.count; i++)
+    {
+        test_checkTiming(&request, &result.timing[i]);
+        CHECK(i == 0 || abs(result.timing[i].samplePoint-875) >= abs(result.timing[i-1].samplePoint-875));
+    }
+
+    request.Fsys=80000000;
+    request.bitRate=1000000;
+    request.propDelay=400;
+    request.samplePoint=750;
+    CHECK(can_computeBitTiming(&request, &result) && result.timing[0].bitRate == 1000000);
+    CHECK(result.timing[0].samplePoint == 750 && result.timing[0].tolerance > 0);
+    for (i=0; i<result.count; i++)
+    {
+        test_checkTiming(&request, &result.timing[i]);
+    }
+
+    request.propDelay=0;
+    request.quanta=10;
+    CHECK(can_computeBitTiming(&request, &result) && result.count == 1 && result.timing[0].quanta == 10);
+    CHECK(result.timing[0].prescaler == 8);
+    request.quanta=3;
+    CHECK(!can_computeBitTiming(&request, &result) && result.count == 0);
+    request.quanta=0;
+    request.bitRate=10; //prescaler above 1024
+    CHECK(!can_computeBitTiming(&request, &result));
+    request.bitRate=1000000;
+    request.propDelay=2000; //more than the bit
+    CHECK(!can_computeBitTiming(&request, &result));
+    request.Fsys=0;
+    CHECK(!can_computeBitTiming(&request, &result));
+}
+/*
+ * Description : can_init() from the table for every clock and rate, and
+ *               from the solver with clockCustom
+ */
+static void test_init(void)
+{
+    can_configStruct config={0};
+    uint32 clock, rate;
+
+    can_sim_reset(16000000);
+    config.module=module0;
+    for (clock=clock16MHz; clock<=clock80MHz; clock++)
+    {
+        for (rate=bitRate125k; rate<=bitRate1M; rate++)
+        {
+            config.clock=(can_clock)clock;
+            config.rate=(can_bitRateSelect)rate;
+            CHECK(can_init(&config));
+            CHECK(TEST_REG(0, 0x18) == 0 && !(TEST_REG(0, 0x00) & 0x01));
+        }
+    }
+    config.clock=(can_clock)(clock80MHz+1);
+    CHECK(!can_init(&config));
+    config.clock=clock16MHz;
+    config.rate=(can_bitRateSelect)(bitRate1M+1);
+    CHECK(!can_init(&config));
+
+    config.clock=clockCustom;
+    config.module=module1;
+    config.Fsys=80000000;
+    config.bitRate=10000; //prescaler 500 with 16 quanta, above the 64 of CANBIT
+    config.delays=200e-9f;
+    CHECK(can_init(&config));
+    CHECK(TEST_REG(1, 0x18) == 7);
+    config.bitRate=10;
+    CHECK(!can_init(&config));
+    config.bitRate=500000;
+    config.n=3;
+    CHECK(!can_init(&config));
+    config.n=0;
+    config.Fsys=500000; //fits 10 kbit/s, but the time stamps count microseconds
+    config.bitRate=10000;
+    CHECK(!can_init(&config));
+}
+/*
+ * Description : the timing can_init() wrote read back for every clock and
+ *               rate, CANBIT rewritten alone keeping the other CANCTL bits
+ */
+static void test_bitTimingRegisters(void)
+{
+    static const uint32 rates[4]={125000, 250000, 500000, 1000000};
+    static const uint32 clocks[4]={16000000, 40000000, 50000000, 80000000};
+    can_configStruct config={0};
+    can_bitTiming timing;
+    can_bitTimingRequest request={0};
+    can_bitTimingResult result;
+    uint32 clock, rate;
+
+    can_sim_reset(16000000);
+    config.module=module1;
+    for (clock=clock16MHz; clock<=clock80MHz; clock++)
+    {
+        for (rate=bitRate125k; rate<=bitRate1M; rate++)
+        {
+            config.clock=(can_clock)clock;
+            config.rate=(can_bitRateSelect)rate;
+            CHECK(can_init(&config));
+            can_getBitTiming(module1, &timing);
+            CHECK(timing.bitRate == rates[rate] && timing.BIT == TEST_REG(1, 0x0C));
+            CHECK(timing.samplePoint >= 800 && timing.samplePoint <= 875 && timing.tolerance > 0);
+            //the table holds the best setting of the solver
+            request.Fsys=clocks[clock-clock16MHz];
+            request.bitRate=rates[rate];
+            CHECK(can_computeBitTiming(&request, &result) && result.timing[0].BIT == TEST_REG(1, 0x0C) &&
+                  result.timing[0].BRPE == TEST_REG(1, 0x18));
+        }
+    }
+    CHECK(TEST_REG(1, 0x00) == 0x0E); //IE, SIE, EIE, out of INIT
+
+    CHECK(can_setBitTiming(module1, 0xFFFF2345, 0xFFFFFFF3));
+    CHECK(TEST_REG(1, 0x0C) == 0x2345 && TEST_REG(1, 0x18) == 0x3 && TEST_REG(1, 0x00) == 0x0E);
+    can_getBitTiming(module1, &timing);
+    CHECK(timing.prescaler == (3<<6 | 5)+1 && timing.sjw == 2 && timing.phaseSeg1 == 4 && timing.phaseSeg2 == 3);
+    CHECK(timing.quanta == 8 && timing.propSeg == 0 && timing.samplePoint == 625);
+}
+/*
+ * Description : objects handed out per pool until each is exhausted, given
+ *               back invalidated and handed out again
+ */
+static void test_allocator(void)
+{
+    can_receiveStruct receive;
+    can_objectHandle handles[16];
+    uint32 i, used;
+
+    test_setup();
+    used=can_usedObjects(module1);
+    CHECK(used == CAN_TX_OBJECT_RANGE_TEST && can_usedObjects(module0) == used);
+    CHECK(can_allocObject(module1, (can_objectPool)(poolFifo+1)) == CAN_NO_OBJECT);
+    CHECK(can_usedObjects(module1) == used);
+    for (i=0; i<CAN_POOL_TX_OBJECTS; i++)
+    {
+        handles[i]=can_allocObject(module1, poolTx);
+        CHECK(handles[i] == CAN_POOL_TX_FIRST+i); //lowest first
+    }
+    CHECK(can_allocObject(module1, poolTx) == CAN_NO_OBJECT);
+    can_freeObject(module1, handles[1]);
+    CHECK(can_allocObject(module1, poolTx) == handles[1]);
+    for (i=0; i<CAN_POOL_TX_OBJECTS; i++)
+    {
+        can_freeObject(module1, handles[i]);
+    }
+    for (i=0; i<CAN_POOL_RX_OBJECTS; i++)
+    {
+        handles[i]=can_allocObject(module1, poolRx);
+        CHECK(handles[i] == CAN_POOL_RX_FIRST+CAN_POOL_RX_OBJECTS-1-i); //highest first
+    }
+    CHECK(can_allocObject(module1, poolRx) == CAN_NO_OBJECT);
+    CHECK(can_allocObject(module0, poolRx) == CAN_POOL_RX_FIRST+CAN_POOL_RX_OBJECTS-1);
+    can_freeObject(module0, CAN_POOL_RX_FIRST+CAN_POOL_RX_OBJECTS-1);
+
+    //a freed receive object no longer takes frames
+    test_receiveStruct(&receive, 0x321, 0x7FF);
+    receive.messageNum=handles[0];
+    can_configureReceive(&receive);
+    CHECK(TEST_REG(1, 0x164) & 0x8000);
+    for (i=0; i<CAN_POOL_RX_OBJECTS; i++)
+    {
+        can_freeObject(module1, handles[i]);
+    }
+    CHECK(!(TEST_REG(1, 0x164) & 0x8000));
+    for (i=0; i<CAN_POOL_FIFO_OBJECTS; i++)
+    {
+        handles[i]=can_allocObject(module1, poolFifo);
+        CHECK(handles[i] != CAN_NO_OBJECT);
+    }
+    CHECK(can_allocObject(module1, poolFifo) == CAN_NO_OBJECT);
+    for (i=0; i<CAN_POOL_FIFO_OBJECTS; i++)
+    {
+        can_freeObject(module1, handles[i]);
+    }
+    can_freeObject(module1, CAN_TX_FIRST_OBJECT); //the transmit queue keeps its objects
+    can_freeObject(module1, 0);
+    can_freeObject(module1, 33);
+    CHECK(can_usedObjects(module1) == used);
+}
+/*
+ * Description : a burst larger than one object kept by a fifo while the ISR
+ *               is held off, read back in arrival order or passed to a
+ *               handler by can_process()
+ */
+static void test_fifo(void)
+{
+    can_receiveStruct receive;
+    can_simFrame frame={0};
+    can_frame received;
+    can_isrLoad load;
+    can_objectHandle first;
+    uint32 i, state;
+    uint16 arb2, mctl;
+    uint8 data[8];
+
+    test_setup();
+    test_receiveStruct(&receive, 0x200, 0x700);
+    CHECK(can_configureRxFifo(&receive, 0) == CAN_NO_OBJECT);
+    CHECK(can_configureRxFifo(&receive, CAN_POOL_FIFO_OBJECTS+1) == CAN_NO_OBJECT);
+    first=can_configureRxFifo(&receive, 16);
+    CHECK(first != CAN_NO_OBJECT);
+    CHECK(can_configureRxFifo(&receive, 1) == CAN_NO_OBJECT); //pool used up
+    test_readObject(1, 2, first, &arb2, &mctl, data);
+    CHECK((arb2 & 0x8000) && !(mctl & 0x80));
+    test_readObject(1, 2, first+15, &arb2, &mctl, data);
+    CHECK((arb2 & 0x8000) && (mctl & 0x80)); //EOB on the last member only
+    frame.dlc=1;
+    state=can_sim_enterCritical();
+    for (i=0; i<12; i++)
+    {
+        frame.ID=0x200+i;
+        frame.data[0]=(uint8)i;
+        can_sim_inject(&frame);
+    }
+    can_sim_runBus(20);
+    can_sim_exitCritical(state);
+    for (i=0; i<12; i++)
+    {
+        CHECK(can_readFrame(module1, &received) && received.ID == 0x200+i && test_frameData(&received) == i &&
+              !(received.flags & CAN_FRAME_LOST));
+    }
+    CHECK(!can_readFrame(module1, &received));
+    can_getIsrLoad(module1, &load, TRUE);
+    CHECK(load.invocations > 0 && load.maxObjects <= CAN_ISR_OBJECT_BUDGET && load.maxObjects >= 3);
+    CHECK(load.maxTicks > 0 && load.maxTicks < 100000000);
+    can_getIsrLoad(module1, &load, FALSE);
+    CHECK(load.invocations == 0);
+
+    //the handlers run from can_process() with a frame budget
+    CHECK(can_registerHandler(normal, 0x200, 0x700, test_handler2));
+    test_calls[2]=0;
+    state=can_sim_enterCritical();
+    for (i=0; i<10; i++)
+    {
+        frame.ID=0x200+i;
+        can_sim_inject(&frame);
+    }
+    can_sim_runBus(20);
+    can_sim_exitCritical(state);
+    CHECK(can_process(4) == 4 && test_calls[2] == 4);
+    CHECK(can_process(100) == 6 && test_calls[2] == 10);
+    CHECK(can_process(100) == 0);
+    CHECK(can_registerHandler(normal, 0x200, 0x700, 0));
+
+    //members are only given back together, the end included
+    can_freeObject(module1, first+15);
+    CHECK(!can_freeRxFifo(module1, first+16));
+    CHECK(can_freeRxFifo(module1, first+3));
+    CHECK(can_usedObjects(module1) == CAN_TX_OBJECT_RANGE_TEST);
+    frame.ID=0x201;
+    can_sim_inject(&frame);
+    can_sim_runBus(5);
+    CHECK(!can_readFrame(module1, &received));
+    CHECK(can_configureRxFifo(&receive, 16) == first);
+    CHECK(can_freeRxFifo(module1, first));
+}
+/*
+ * Description : frames sent back to back through both interfaces, an object
+ *               reloaded with the same id, mask and length gets only its data
+ */
+static void test_transmitBatch(void)
+{
+    can_transmitStruct frames[CAN_POOL_TX_OBJECTS];
+    can_simFrame log;
+    uint32 i;
+
+    test_setup();
+    for (i=0; i<CAN_POOL_TX_OBJECTS; i++)
+    {
+        frames[i]=(can_transmitStruct){0};
+        frames[i].module=module0;
+        frames[i].ID=0x400+i;
+        frames[i].ID_mask=0x7FF;
+        frames[i].bytesNum=8;
+        frames[i].Data=0x1100+i;
+        frames[i].messageNum=can_allocObject(module0, poolTx);
+        CHECK(frames[i].messageNum != CAN_NO_OBJECT);
+    }
+    CHECK(can_transmitBatch(frames, CAN_POOL_TX_OBJECTS) == CAN_POOL_TX_OBJECTS);
+    can_sim_runBus(10);
+    for (i=0; i<CAN_POOL_TX_OBJECTS; i++)
+    {
+        CHECK(can_sim_readBusLog(&log) && log.source == 0 && log.ID == 0x400+i && log.dlc == 8 &&
+              log.data[0] == 0x00+i && log.data[1] == 0x11);
+    }
+    CHECK(!can_sim_readBusLog(&log));
+
+    //the id of the first object changed behind the driver's back: a reload
+    //with the same frame keeps it, a reload with another length rewrites it
+    test_writeObject(0, 1, frames[0].messageNum, 0x555, 0x7FF, 0xA000, 0x0088, 0);
+    can_sim_flush();
+    frames[0].Data=0x2200;
+    CHECK(can_transmitBatch(frames, 1) == 1);
+    can_sim_runBus(2);
+    CHECK(can_sim_readBusLog(&log) && log.ID == 0x555 && log.data[0] == 0x00 && log.data[1] == 0x22);
+    frames[0].bytesNum=2;
+    CHECK(can_transmitBatch(frames, 1) == 1);
+    can_sim_runBus(2);
+    CHECK(can_sim_readBusLog(&log) && log.ID == 0x400 && log.dlc == 2 && log.data[1] == 0x22);
+    CHECK(!can_sim_readBusLog(&log));
+    for (i=0; i<CAN_POOL_TX_OBJECTS; i++)
+    {
+        can_freeObject(module0, frames[i].messageNum);
+    }
+}
+/*
+ * Description : consecutive calls programmed through IF1 and IF2 in turn
+ */
+static void test_interfaceTurn(void)
+{
+    can_transmitStruct transmit={0};
+    can_simFrame log;
+    uint32 arb2[2];
+
+    test_setup();
+    transmit.module=module0;
+    transmit.ID=0x501;
+    transmit.ID_mask=0x7FF;
+    transmit.bytesNum=1;
+    transmit.messageNum=can_allocObject(module0, poolTx);
+    CHECK(can_transmit(&transmit));
+    transmit.ID=0x502;
+    transmit.messageNum=can_allocObject(module0, poolTx);
+    CHECK(can_transmit(&transmit));
+    arb2[0]=TEST_IF(0, 1, 0x14) & 0x1FFC;
+    arb2[1]=TEST_IF(0, 2, 0x14) & 0x1FFC;
+    CHECK(arb2[0] != arb2[1] && (arb2[0] == 0x501<<2 || arb2[0] == 0x502<<2) &&
+          (arb2[1] == 0x501<<2 || arb2[1] == 0x502<<2));
+    CHECK(can_sim_runBus(10) == 2);
+    CHECK(can_sim_readBusLog(&log) && log.ID == 0x501);
+    CHECK(can_sim_readBusLog(&log) && log.ID == 0x502);
+    can_freeObject(module0, transmit.messageNum-1);
+    can_freeObject(module0, transmit.messageNum);
+}
+/*
+ * Description : interfaces held busy by the model: the calls that need them
+ *               report the timeout and a fifo is rolled back or kept whole
+ */
+static void test_interfaceBusy(void)
+{
+    can_transmitStruct transmit={0};
+    can_transmitStruct frames[4];
+    can_updateStruct update={0};
+    can_receiveStruct receive;
+    can_simFrame log;
+    can_objectHandle first;
+    uint32 used, i;
+
+    test_setup();
+    transmit.module=module0;
+    transmit.ID=0x520;
+    transmit.ID_mask=0x7FF;
+    transmit.bytesNum=1;
+    transmit.messageNum=can_allocObject(module0, poolTx);
+    update.module=module0;
+    update.bytesNum=1;
+    update.messageNum=transmit.messageNum;
+    can_sim_setBusy(0, 1, TRUE);
+    CHECK(!can_transmit_CAN0(&transmit));
+    CHECK(!can_updateMessage_CAN0(&update));
+    CHECK(can_sim_runBus(2) == 0);
+    can_sim_setBusy(0, 1, FALSE);
+    CHECK(can_transmit_CAN0(&transmit));
+    CHECK(can_sim_runBus(2) == 1 && can_sim_readBusLog(&log) && log.ID == 0x520);
+    can_sim_setBusy(0, 1, TRUE);
+    can_sim_setBusy(0, 2, TRUE);
+    CHECK(!can_transmit(&transmit));
+    CHECK(!can_updateMessage(&update));
+    CHECK(can_sim_runBus(2) == 0);
+    can_sim_setBusy(0, 1, FALSE);
+    can_sim_setBusy(0, 2, FALSE);
+    CHECK(can_updateMessage(&update));
+    CHECK(can_sim_runBus(2) == 1 && can_sim_readBusLog(&log) && log.ID == 0x520);
+
+    //a batch stops at the first interface that stays busy
+    for (i=0; i<4; i++)
+    {
+        frames[i]=transmit;
+        frames[i].ID=0x530+i;
+    }
+    can_sim_setBusy(0, 1, TRUE);
+    can_sim_setBusy(0, 2, TRUE);
+    CHECK(can_transmitBatch(frames, 4) == 0);
+    can_sim_setBusy(0, 1, FALSE);
+    i=can_transmitBatch(frames, 4);
+    CHECK(i <= 1 && can_sim_runBus(5) == i);
+    can_sim_setBusy(0, 2, FALSE);
+    while (can_sim_readBusLog(&log))
+    {
+    }
+    can_freeObject(module0, transmit.messageNum);
+
+    //a fifo that cannot be written completely is invalidated and freed
+    test_receiveStruct(&receive, 0x540, 0x7FF);
+    used=can_usedObjects(module1);
+    can_sim_setBusy(1, 1, TRUE);
+    can_sim_setBusy(1, 2, TRUE);
+    CHECK(can_configureRxFifo(&receive, 4) == CAN_NO_OBJECT);
+    CHECK(can_usedObjects(module1) == used);
+    can_sim_setBusy(1, 1, FALSE);
+    CHECK(can_configureRxFifo(&receive, 4) == CAN_NO_OBJECT);
+    CHECK(can_usedObjects(module1) == used);
+    CHECK(!((TEST_REG(1, 0x160) | TEST_REG(1, 0x164)<<16) &
+            (uint32)CAN_OBJECT_RANGE(CAN_POOL_FIFO_FIRST, CAN_POOL_FIFO_OBJECTS)));
+    can_sim_setBusy(1, 2, FALSE);
+
+    //a fifo is only given back when every member could be invalidated
+    first=can_configureRxFifo(&receive, 4);
+    CHECK(first != CAN_NO_OBJECT);
+    can_sim_setBusy(1, 1, TRUE);
+    can_sim_setBusy(1, 2, TRUE);
+    CHECK(!can_freeRxFifo(module1, first));
+    CHECK(can_usedObjects(module1) == (used | (uint32)CAN_OBJECT_RANGE(first, 4)));
+    can_sim_setBusy(1, 2, FALSE);
+    CHECK(can_freeRxFifo(module1, first));
+    CHECK(can_usedObjects(module1) == used);
+    CHECK(!((TEST_REG(1, 0x160) | TEST_REG(1, 0x164)<<16) & (uint32)CAN_OBJECT_RANGE(first, 4)));
+    can_sim_setBusy(1, 1, FALSE);
+}
+/*
+ * Description : an update of the first bytes of an object leaves the others
+ *               and the length of the object as they were
+ */
+static void test_update(void)
+{
+    can_transmitStruct transmit={0};
+    can_updateStruct update={0};
+    can_simFrame log;
+    static const uint8 expected[8]={0xDD, 0xCC, 0xBB, 0xAA, 0x05, 0x06, 0x07, 0x08};
+    uint32 i;
+
+    test_setup();
+    transmit.module=module0;
+    transmit.ID=0x510;
+    transmit.ID_mask=0x7FF;
+    transmit.bytesNum=8;
+    transmit.Data=0x0807060504030201ULL;
+    transmit.messageNum=can_allocObject(module0, poolTx);
+    CHECK(can_transmit(&transmit));
+    can_sim_runBus(2);
+    CHECK(can_sim_readBusLog(&log) && log.data[0] == 0x01 && log.data[7] == 0x08);
+    update.module=module0;
+    update.bytesNum=4;
+    update.Data=0xFFFFFFFFAABBCCDDULL;
+    update.messageNum=transmit.messageNum;
+    CHECK(can_updateMessage(&update));
+    can_sim_runBus(2);
+    CHECK(can_sim_readBusLog(&log) && log.ID == 0x510 && log.dlc == 8);
+    for (i=0; i<8; i++)
+    {
+        CHECK(log.data[i] == expected[i]);
+    }
+    update.bytesNum=0; //TXRQST alone sends the object again
+    CHECK(can_updateMessage(&update));
+    can_sim_runBus(2);
+    CHECK(can_sim_readBusLog(&log) && log.ID == 0x510 && log.data[0] == 0xDD && log.data[7] == 0x08);
+    //bytes past bytesNum inside a transferred half keep their value
+    update.bytesNum=1;
+    update.Data=0xEE;
+    CHECK(can_updateMessage(&update));
+    can_sim_runBus(2);
+    CHECK(can_sim_readBusLog(&log) && log.data[0] == 0xEE && log.data[1] == 0xCC && log.data[3] == 0xAA);
+    update.bytesNum=6;
+    update.Data=0x112233445566ULL;
+    CHECK(can_updateMessage(&update));
+    can_sim_runBus(2);
+    CHECK(can_sim_readBusLog(&log) && log.data[0] == 0x66 && log.data[5] == 0x11 && log.data[6] == 0x07 &&
+          log.data[7] == 0x08);
+    CHECK(!can_sim_readBusLog(&log));
+    can_freeObject(module0, transmit.messageNum);
+}
+/*
+ * Description : can_frame queued with can_sendFrame(), its bytes on the bus
+ *               in order, the frame read back and handed to the TX callback
+ */
+static void test_sendFrame(void)
+{
+    can_receiveStruct receive;
+    can_frame frame={0}, received;
+    can_simFrame log;
+    uint8 i;
+
+    CHECK(sizeof(can_frame) == 32 && _Alignof(can_frame) == 16);
+    test_setup();
+    test_receiveStruct(&receive, 0x1F00000, 0x1FFFFF00);
+    receive.ID_type=extended;
+    receive.messageNum=can_allocObject(module1, poolRx);
+    can_configureReceive(&receive);
+    test_txDone=0;
+    can_setTxCallback(module0, test_txCallback);
+    frame.ID=0x1F00042;
+    frame.flags=CAN_FRAME_EXTENDED;
+    frame.dlc=5;
+    for (i=0; i<5; i++)
+    {
+        frame.data[i]=0x10+i;
+    }
+    CHECK(can_sendFrame(module0, &frame));
+    can_sim_runBus(4);
+    CHECK(can_sim_readBusLog(&log) && log.ID == 0x1F00042 && log.extended && log.dlc == 5);
+    CHECK(log.data[0] == 0x10 && log.data[4] == 0x14);
+    can_process(0);
+    CHECK(test_txDone == 1 && test_lastSentId == 0x1F00042);
+    CHECK(can_readFrame(module1, &received) && received.ID == 0x1F00042 && received.dlc == 5);
+    CHECK(received.flags == CAN_FRAME_EXTENDED && received.messageNum == receive.messageNum);
+    CHECK(test_frameData(&received) == 0x1413121110ULL);
+    can_setTxCallback(module0, 0);
+    can_freeObject(module1, receive.messageNum);
+}
+/*
+ * Description : a peeked frame stays in place, not overwritten by the ISR
+ *               while the ring fills up, until it is released
+ */
+static void test_peekFrame(void)
+{
+    can_receiveStruct receive;
+    can_simFrame frame={0};
+    const can_frame* slot;
+    uint32 i, overflows;
+
+    test_setup();
+    test_receiveStruct(&receive, 0x300, 0x700);
+    receive.messageNum=can_allocObject(module1, poolRx);
+    can_configureReceive(&receive);
+    CHECK(can_peekFrame(module1) == 0);
+    can_releaseFrame(module1); //nothing to release
+    overflows=can_rxOverflows(module1);
+    frame.dlc=1;
+    for (i=0; i<CAN_RX_RING_SIZE+2; i++)
+    {
+        frame.ID=0x300+i;
+        frame.data[0]=(uint8)i;
+        can_sim_inject(&frame);
+        can_sim_busStep();
+        if (i == 0)
+        {
+            slot=can_peekFrame(module1);
+            CHECK(slot != 0 && slot->ID == 0x300 && slot->data[0] == 0);
+        }
+    }
+    CHECK(can_peekFrame(module1) == slot && slot->ID == 0x300 && slot->data[0] == 0);
+    CHECK(can_rxPending(module1) == CAN_RX_RING_SIZE && can_rxOverflows(module1) == overflows+2);
+    can_releaseFrame(module1);
+    slot=can_peekFrame(module1);
+    CHECK(slot != 0 && slot->ID == 0x301 && can_rxPending(module1) == CAN_RX_RING_SIZE-1);
+    for (i=1; i<CAN_RX_RING_SIZE; i++)
+    {
+        slot=can_peekFrame(module1);
+        CHECK(slot != 0 && slot->ID == 0x300+i);
+        can_releaseFrame(module1);
+    }
+    CHECK(can_peekFrame(module1) == 0);
+    can_freeObject(module1, receive.messageNum);
+}
+/*
+ * Description : frames passed to the handlers of their standard id, exact
+ *               extended id or masked extended filter, a budget per call
+ */
+static void test_dispatch(void)
+{
+    can_receiveStruct receive;
+    can_simFrame frame={0};
+    can_objectHandle standardObject;
+    uint32 i;
+
+    test_setup();
+    memset(test_calls, 0, sizeof(test_calls));
+    test_receiveStruct(&receive, 0, 0);
+    receive.messageNum=can_allocObject(module1, poolRx);
+    can_receive(&receive);
+    standardObject=receive.messageNum;
+    receive.ID_type=extended;
+    receive.messageNum=can_allocObject(module1, poolRx);
+    can_receive(&receive);
+    CHECK(can_registerHandler(normal, 0x120, 0x7F0, test_handler0));
+    CHECK(can_registerHandler(normal, 0x125, 0x7FF, test_handler1));
+    CHECK(can_registerHandler(extended, 0x1ABCDE, 0x1FFFFFFF, test_handler2));
+    CHECK(can_registerHandler(extended, 0x100000, 0x1FF00000, test_handler0));
+    frame.dlc=1;
+    frame.ID=0x121; can_sim_inject(&frame);
+    frame.ID=0x125; can_sim_inject(&frame);
+    frame.ID=0x130; can_sim_inject(&frame);
+    frame.extended=TRUE;
+    frame.ID=0x1ABCDE; can_sim_inject(&frame);
+    frame.ID=0x1ABCDF; can_sim_inject(&frame);
+    frame.ID=0x2ABCDF; can_sim_inject(&frame);
+    can_sim_runBus(20);
+    CHECK(can_dispatch(module1, 2) == 2 && test_calls[0] == 1 && test_calls[1] == 1);
+    CHECK(can_dispatch(module1, 100) == 4);
+    CHECK(test_calls[0] == 2 && test_calls[1] == 1 && test_calls[2] == 1);
+    CHECK(can_rxPending(module1) == 0);
+    CHECK(can_registerHandler(extended, 0x1ABCDE, 0x1FFFFFFF, 0));
+    frame.ID=0x1ABCDE;
+    can_sim_inject(&frame);
+    can_sim_runBus(5);
+    can_dispatch(module1, 10);
+    CHECK(test_calls[2] == 1 && test_calls[0] == 3);
+
+    //more functions than CAN_HANDLERS, one registered at a time
+    CHECK(can_registerHandler(normal, 0x120, 0x7F0, 0));
+    CHECK(can_registerHandler(normal, 0x125, 0x7FF, 0));
+    CHECK(can_registerHandler(extended, 0x100000, 0x1FF00000, 0));
+    for (i=0; i<40; i++)
+    {
+        CHECK(can_registerHandler(normal, 0x200, 0x7FF, test_handlers[i]));
+        CHECK(can_registerHandler(normal, 0x200, 0x7FF, 0));
+    }
+    can_freeObject(module1, standardObject);
+    can_freeObject(module1, receive.messageNum);
+}
+/*
+ * Description : more ids than objects: the masks of the objects let the ids
+ *               through, the software filter drops the ids beyond the set
+ */
+static void test_filter(void)
+{
+    can_simFrame frame={0};
+    can_frame received;
+    static const uint32 ids[6]={0x100, 0x101, 0x102, 0x103, 0x700, 0x701};
+    static const uint32 apart[2]={0x100, 0x103};
+    static uint32 many[CAN_MASK_IDS+1];
+    static can_idMask manyCubes[CAN_MASK_IDS+1];
+    can_idMask cubes[6];
+    can_stats stats;
+    uint32 i, used, free, accepted=0;
+    uint8 objects;
+
+    test_setup();
+    can_getStats(module1, &stats, TRUE);
+    for (i=0; i<40; i++)
+    {
+        CHECK(can_filterAdd(module1, normal, 0x100+i*7));
+    }
+    for (i=0; i<20; i++)
+    {
+        CHECK(can_filterAdd(module1, extended, 0x1000000+i*13));
+    }
+    objects=can_filterApply(module1, 6);
+    CHECK(objects >= 2 && objects <= 6);
+    frame.dlc=1;
+    for (i=0; i<0x800; i++)
+    {
+        frame.ID=i;
+        can_sim_inject(&frame);
+        can_sim_runBus(1);
+        while (can_readFrame(module1, &received))
+        {
+            accepted++;
+            CHECK(received.ID >= 0x100 && (received.ID-0x100)%7 == 0 && received.ID < 0x100+40*7);
+        }
+    }
+    CHECK(accepted == 40);
+    accepted=0;
+    frame.extended=TRUE;
+    for (i=0; i<400; i++)
+    {
+        frame.ID=0x1000000+i;
+        can_sim_inject(&frame);
+        can_sim_runBus(1);
+        while (can_readFrame(module1, &received))
+        {
+            accepted++;
+            CHECK((received.ID-0x1000000)%13 == 0);
+        }
+    }
+    CHECK(accepted == 20);
+    CHECK(can_filterRejected(module1) > 0);
+    can_getStats(module1, &stats, FALSE);
+    CHECK(stats.rxFrames == 60); //rejected frames are not counted
+
+    //a call the rx pool cannot serve keeps the previous objects receiving,
+    //a successful one frees them after taking its own
+    used=can_usedObjects(module1);
+    free=__builtin_popcount((uint32)CAN_OBJECT_RANGE(CAN_POOL_RX_FIRST, CAN_POOL_RX_OBJECTS) & ~used);
+    CHECK(can_filterApply(module1, (uint8)(free+1)) == 0);
+    CHECK(can_usedObjects(module1) == used);
+    frame.extended=FALSE;
+    frame.ID=0x100;
+    can_sim_inject(&frame);
+    can_sim_runBus(1);
+    CHECK(can_readFrame(module1, &received) && received.ID == 0x100);
+    CHECK(can_filterApply(module1, 2) == 2);
+    CHECK(__builtin_popcount(can_usedObjects(module1)) == __builtin_popcount(used)-objects+2);
+    can_sim_inject(&frame);
+    can_sim_runBus(1);
+    CHECK(can_readFrame(module1, &received) && received.ID == 0x100);
+    CHECK(can_computeMasks(ids, 6, normal, cubes, 2) == 2);
+    CHECK(can_falseAccepts(ids, 6, normal, cubes, 2) == 0);
+    CHECK(cubes[0].ID == 0x100 && cubes[0].mask == 0x7FC && cubes[1].ID == 0x700 && cubes[1].mask == 0x7FE);
+    //one object accepts 0x101 and 0x102 as well, a second one is split off
+    CHECK(can_computeMasks(apart, 2, normal, cubes, 1) == 1 && can_falseAccepts(apart, 2, normal, cubes, 1) == 2);
+    CHECK(can_computeMasks(apart, 2, normal, cubes, 4) == 2 && can_falseAccepts(apart, 2, normal, cubes, 2) == 0);
+    //the merging cost grows with the cube of the count, more ids are refused
+    for (i=0; i<=CAN_MASK_IDS; i++)
+    {
+        many[i]=i*3;
+    }
+    CHECK(can_computeMasks(many, CAN_MASK_IDS+1, normal, manyCubes, 4) == 0);
+    CHECK(can_computeMasks(many, CAN_MASK_IDS, normal, manyCubes, 4) == 4);
+    CHECK(can_falseAccepts(many, CAN_MASK_IDS, normal, manyCubes, 4) < 0x800);
+}
+/*
+ * Description : status interrupts served before the objects, the error state
+ *               passed to the callback by can_process() and kept for
+ *               can_getStatus(), the bus health counters of can_getStats()
+ */
+static void test_status(void)
+{
+    can_receiveStruct receive;
+    can_frame frame={0}, received;
+    can_stats stats;
+
+    test_setup();
+    test_statusCalls=0;
+    can_setStatusCallback(module1, test_statusCallback);
+    can_sim_busError(1, CAN_STS_LEC_STUFF, 10, 0);
+    CHECK(test_statusCalls == 0); //the callback runs from can_process()
+    CHECK((TEST_REG(1, 0x04) & CAN_STS_LEC_M) == CAN_STS_LEC_NOEVENT); //written back
+    can_process(0);
+    CHECK(test_statusCalls == 1 && (test_lastStatus & CAN_STS_LEC_M) == CAN_STS_LEC_STUFF);
+    can_sim_busError(1, CAN_STS_LEC_CRC, 130, 0);
+    can_process(0);
+    CHECK(test_statusCalls == 2 && (test_lastStatus & CAN_STS_EPASS) && (can_getStatus(module1) & CAN_STS_EWARN));
+    can_sim_busError(1, CAN_STS_LEC_BIT0, 256, 0);
+    can_process(0);
+    CHECK(test_statusCalls == 3 && (can_getStatus(module1) & CAN_STS_BOFF));
+    CHECK(can_eventOverflows(module1) == 0);
+    can_setStatusCallback(module1, 0);
+    can_sim_busError(1, CAN_STS_LEC_STUFF, 0, 0);
+    can_process(0);
+    CHECK(test_statusCalls == 3);
+
+    //counters of the error codes and state transitions, frames both ways
+    test_setup();
+    can_getStats(module0, &stats, TRUE);
+    can_getStats(module1, &stats, TRUE);
+    can_sim_busError(0, CAN_STS_LEC_STUFF, 20, 5);
+    can_sim_busError(0, CAN_STS_LEC_CRC, 100, 7);
+    can_sim_busError(0, CAN_STS_LEC_CRC, 130, 3);
+    can_sim_busError(0, CAN_STS_LEC_ACK, 256, 3);
+    can_getStats(module0, &stats, TRUE);
+    CHECK(stats.lec[CAN_STS_LEC_STUFF] == 1 && stats.lec[CAN_STS_LEC_CRC] == 2 && stats.lec[CAN_STS_LEC_ACK] == 1);
+    CHECK(stats.errorWarning == 1 && stats.errorPassive == 1 && stats.busOff == 1);
+    CHECK(stats.peakRec == 7 && stats.peakTec >= 130);
+    can_getStats(module0, &stats, FALSE);
+    CHECK(stats.txOk == 0 && stats.busOff == 0 && stats.peakTec == 0);
+    test_setup();
+    test_receiveStruct(&receive, 0x600, 0x700);
+    receive.messageNum=can_allocObject(module1, poolRx);
+    can_configureReceive(&receive);
+    frame.dlc=1;
+    frame.ID=0x601;
+    CHECK(can_sendFrame(module0, &frame));
+    frame.ID=0x602;
+    CHECK(can_sendFrame(module0, &frame));
+    can_sim_runBus(5);
+    while (can_readFrame(module1, &received));
+    can_getStats(module0, &stats, TRUE);
+    CHECK(stats.txFrames == 2 && stats.rxFrames == 0);
+    can_getStats(module1, &stats, TRUE);
+    CHECK(stats.rxFrames == 2 && stats.txFrames == 0);
+    can_freeObject(module1, receive.messageNum);
+}
+/*
+ * Description : bus-off with back-off, immediate and manual recovery, the
+ *               queued frame sent once the module is back on the bus
+ */
+static void test_busOff(void)
+{
+    can_receiveStruct receive;
+    can_busOffInfo info;
+    can_frame frame={0}, received;
+    uint32 count;
+
+    test_setup();
+    test_receiveStruct(&receive, 0x100, 0x700);
+    receive.messageNum=can_allocObject(module1, poolRx);
+    can_configureReceive(&receive);
+    can_getBusOffInfo(module0, &info);
+    count=info.count;
+    can_sim_busError(0, CAN_STS_LEC_BIT0, 256, 12);
+    can_getBusOffInfo(module0, &info);
+    CHECK(info.state == busOffWaiting && info.count == count+1 && info.lastTec == 255 && info.lastRec == 12);
+    frame.ID=0x123;
+    frame.dlc=2;
+    frame.data[0]=0xAA;
+    CHECK(can_sendFrame(module0, &frame));
+    can_process(10);
+    can_getBusOffInfo(module0, &info);
+    CHECK(info.state == busOffWaiting);
+    can_sim_advanceTime(10000000ULL); //CAN_BUSOFF_FIRST_DELAY
+    can_process(10);
+    can_getBusOffInfo(module0, &info);
+    CHECK(info.state == busOffRecovering);
+    can_sim_advanceTime(3000000ULL); //129x11 bits at 500 kbit/s
+    can_getBusOffInfo(module0, &info);
+    CHECK(info.state == busOn && info.lastRecoveryUs >= 12838 && info.lastRecoveryUs <= 13100);
+    can_sim_runBus(5);
+    CHECK(can_readFrame(module1, &received) && received.ID == 0x123 && received.data[0] == 0xAA);
+
+    //a second bus-off in a row waits twice as long
+    can_sim_busError(0, CAN_STS_LEC_BIT0, 256, 0);
+    can_sim_advanceTime(10000000ULL);
+    can_process(10);
+    can_sim_advanceTime(3000000ULL);
+    can_sim_busError(0, CAN_STS_LEC_BIT0, 256, 0);
+    can_sim_advanceTime(15000000ULL);
+    can_process(10);
+    can_getBusOffInfo(module0, &info);
+    CHECK(info.state == busOffWaiting && info.consecutive == 2);
+    can_sim_advanceTime(5000000ULL);
+    can_process(10);
+    can_getBusOffInfo(module0, &info);
+    CHECK(info.state == busOffRecovering);
+
+    can_sim_advanceTime(3000000ULL);
+    can_setBusOffRecovery(module0, busOffImmediate, 0, 0);
+    can_sim_busError(0, CAN_STS_LEC_BIT1, 256, 0);
+    can_getBusOffInfo(module0, &info);
+    CHECK(info.state == busOffRecovering);
+    can_sim_advanceTime(3000000ULL);
+    can_getBusOffInfo(module0, &info);
+    CHECK(info.state == busOn && info.lastRecoveryUs <= 3000);
+
+    can_setBusOffRecovery(module0, busOffManual, 0, 0);
+    CHECK(!can_busOffRecover(module0));
+    can_sim_busError(0, CAN_STS_LEC_BIT1, 256, 0);
+    can_sim_advanceTime(2000000000ULL);
+    can_process(10);
+    can_getBusOffInfo(module0, &info);
+    CHECK(info.state == busOffWaiting);
+    CHECK(can_busOffRecover(module0));
+    can_sim_advanceTime(3000000ULL);
+    can_getBusOffInfo(module0, &info);
+    CHECK(info.state == busOn);
+    can_setBusOffRecovery(module0, busOffBackoff, 0, 0);
+    can_freeObject(module1, receive.messageNum);
+}
+/*
+ * Description : a frame stamped at the end of its bus time less
+ *               CAN_RX_LATENCY, the frames read by one invocation of the ISR
+ *               with the same stamp (CAN_RX_TIMESTAMP_AT_ENTRY) or in order
+ */
+static void test_timestamp(void)
+{
+    can_receiveStruct receive;
+    can_simFrame frame={0}, log;
+    can_frame received[4];
+    can_objectHandle first;
+    uint32 i, state;
+
+    test_setup();
+    test_receiveStruct(&receive, 0x700, 0x700);
+    first=can_configureRxFifo(&receive, 4);
+    CHECK(first != CAN_NO_OBJECT);
+    frame.ID=0x701;
+    can_sim_inject(&frame);
+    can_sim_runBus(2);
+    CHECK(can_sim_readBusLog(&log) && can_readFrame(module1, &received[0]));
+    CHECK(received[0].timestamp == log.timeNs-CAN_RX_LATENCY);
+
+    state=can_sim_enterCritical();
+    for (i=0; i<4; i++)
+    {
+        can_sim_inject(&frame);
+    }
+    can_sim_runBus(5);
+    can_sim_exitCritical(state);
+    for (i=0; i<4; i++)
+    {
+        CHECK(can_sim_readBusLog(&log) && can_readFrame(module1, &received[i]));
+    }
+    for (i=1; i<4; i++)
+    {
+#if CAN_RX_TIMESTAMP_AT_ENTRY
+        CHECK(received[i].timestamp == received[0].timestamp);
+#else
+        CHECK(received[i].timestamp > received[i-1].timestamp);
+#endif
+    }
+    CHECK(received[0].timestamp >= log.timeNs-CAN_RX_LATENCY); //the ISR ran after the last frame
+    CHECK(can_freeRxFifo(module1, first));
+}
+/*
+ * Description : queueing and bus delay histograms of a tracked id
+ */
+static void test_txLatency(void)
+{
+    can_frame frame={0};
+    can_txLatency latency;
+    uint32 i, queued=0, bus=0;
+
+    test_setup();
+    CHECK(can_txLatencyTrack(module0, normal, 0x300));
+    CHECK(!can_getTxLatency(module0, normal, 0x301, &latency, FALSE));
+    frame.ID=0x300;
+    frame.dlc=8;
+    for (i=0; i<6; i++)
+    {
+        CHECK(can_sendFrame(module0, &frame)); //CAN_TX_OBJECTS objects, the others wait
+    }
+    can_sim_runBus(20);
+    CHECK(can_getTxLatency(module0, normal, 0x300, &latency, TRUE));
+    for (i=0; i<CAN_TX_LATENCY_BUCKETS; i++)
+    {
+        queued +=latency.queueHistogram[i];
+        bus +=latency.busHistogram[i];
+    }
+    CHECK(latency.frames == 6 && queued == 6 && bus == 6);
+    CHECK(latency.maxQueue > 0 && latency.maxBus >= 4*221000); //four frames of 222 us ahead
+    //the first frames got an object at once, a few reads of test_clock() later
+    CHECK(latency.queueHistogram[0]+latency.queueHistogram[1]+latency.queueHistogram[2] == CAN_TX_OBJECTS);
+    can_getTxLatency(module0, normal, 0x300, &latency, FALSE);
+    CHECK(latency.frames == 0 && latency.ID == 0x300);
+}
+/*
+ * Description : CAN_FRAME_REMOTE goes out as an RTR, the freed object does
+ *               not answer, an answer that reaches it first is received
+ */
+static void test_remote(void)
+{
+    can_frame frame={0}, received;
+    can_simFrame log, request={0};
+    uint32 state;
+
+    test_setup();
+    test_txDone=0;
+    can_setTxCallback(module0, test_txCallback);
+    frame.ID=0x55;
+    frame.dlc=2;
+    frame.data[0]=0xAA;
+    frame.flags=CAN_FRAME_REMOTE;
+    while (can_sim_readBusLog(&log));
+    CHECK(can_sendFrame(module0, &frame));
+    CHECK(can_sim_runBus(10) == 1);
+    CHECK(can_sim_readBusLog(&log) && log.remote && log.dlc == 2 && log.ID == 0x55 && log.source == 0);
+    request.ID=0x55;
+    request.remote=TRUE;
+    request.dlc=2;
+    can_sim_inject(&request);
+    CHECK(can_sim_runBus(10) == 1);
+    CHECK(can_sim_readBusLog(&log) && log.remote && !can_sim_readBusLog(&log));
+
+    state=can_sim_enterCritical();
+    CHECK(can_sendFrame(module0, &frame));
+    CHECK(can_sim_runBus(1) == 1);
+    request.remote=FALSE;
+    request.data[0]=0x77;
+    can_sim_inject(&request);
+    CHECK(can_sim_runBus(10) == 1);
+    can_sim_exitCritical(state);
+    while (can_sim_readBusLog(&log)); //the answer is the last frame
+    CHECK(can_readFrame(module0, &received) && received.ID == 0x55 && received.data[0] == 0x77);
+    CHECK(!(received.flags & CAN_FRAME_REMOTE));
+    //stamped like a received frame: at ISR entry or when read, less the latency
+    CHECK(received.timestamp >= log.timeNs-CAN_RX_LATENCY && received.timestamp <= log.timeNs+2-CAN_RX_LATENCY);
+    can_process(0);
+    CHECK(test_txDone == 2 && test_lastSentId == 0x55);
+    can_setTxCallback(module0, 0);
+}
+/*
+ * Description : test modes outside can_testingType refused, the others
+ *               setting CANCTL.TEST and their CANTST bits
+ */
+static void test_testMode(void)
+{
+    can_testingStruct testing={0};
+
+    test_setup();
+    testing.module=module0;
+    testing.mode=(can_testingType)7;
+    CHECK(!can_enableTestMode(&testing));
+    CHECK(!(TEST_REG(0, 0x00) & CAN_CTL_TEST));
+    testing.mode=receive;
+    CHECK(can_enableTestMode(&testing));
+    CHECK((TEST_REG(0, 0x00) & CAN_CTL_TEST) && (TEST_REG(0, 0x14) & CAN_TST_RX));
+    testing.mode=physicalHigh;
+    CHECK(can_enableTestMode(&testing));
+    CHECK((TEST_REG(0, 0x14) & CAN_TST_TX_M) == CAN_TST_TX_RECESSIVE);
+    testing.mode=physicalLow; //replaces the pin state instead of adding to it
+    CHECK(can_enableTestMode(&testing));
+    CHECK((TEST_REG(0, 0x14) & CAN_TST_TX_M) == CAN_TST_TX_DOMINANT);
+    TEST_REG(0, 0x14)=0;
+    TEST_REG(0, 0x00) &=~CAN_CTL_TEST;
+}
+#if CAN_PROFILE
+static void test_profileInner(void)
+{
+    CAN_PROFILE_FUNCTION(test_profileInner);
+    uint32 start=can_sim_monotonicNs();
+
+    while (can_sim_monotonicNs() == start); //at least one tick
+}
+static void test_profileOuter(void)
+{
+    CAN_PROFILE_FUNCTION(test_profileOuter);
+    test_profileInner();
+    test_profileInner();
+}
+/*
+ * Description : calls and cycles of the public functions, the ISR and the
+ *               compile-time instances, nested calls taken out of the
+ *               exclusive cycles of the caller
+ */
+static void test_profile(void)
+{
+    can_transmitStruct transmit={0};
+    can_frame frame={0};
+    can_profile profile, outer={0}, inner={0};
+    uint32 i, found=0;
+
+    can_profileReset();
+    test_setup();
+    frame.ID=0x10;
+    for (i=0; i<5; i++)
+    {
+        can_sendFrame(module0, &frame);
+        can_sim_runBus(2);
+    }
+    transmit.module=module0;
+    transmit.ID=0x20;
+    transmit.bytesNum=1;
+    transmit.messageNum=20;
+    CHECK(can_transmit_CAN0(&transmit));
+    test_profileOuter();
+    for (i=0; can_getProfile(i, &profile); i++)
+    {
+        if (strcmp(profile.name, "can_transmit_CAN0") == 0)
+        {
+            CHECK(profile.calls == 1 && profile.exclusiveCycles == profile.totalCycles);
+            found++;
+        }
+        if (strcmp(profile.name, "test_profileOuter") == 0)
+        {
+            outer=profile;
+        }
+        if (strcmp(profile.name, "test_profileInner") == 0)
+        {
+            inner=profile;
+        }
+        if (strcmp(profile.name, "can_init") == 0)
+        {
+            CHECK(profile.calls == 2);
+            found++;
+        }
+        if (strcmp(profile.name, "can_sendFrame") == 0)
+        {
+            CHECK(profile.calls == 5 && profile.minCycles <= profile.maxCycles);
+            found++;
+        }
+        if (strcmp(profile.name, "CAN0_Handler") == 0)
+        {
+            found++;
+        }
+    }
+    CHECK(found == 4);
+    CHECK(outer.calls == 1 && inner.calls == 2 && inner.exclusiveCycles == inner.totalCycles);
+    CHECK(outer.exclusiveCycles < outer.totalCycles && outer.exclusiveCycles+inner.totalCycles == outer.totalCycles);
+    can_profileReset();
+    CHECK(can_getProfile(0, &profile) && profile.calls == 0);
+}
+#endif
+/*******************************************************************************
+ *                      Functions Definitions                                  *
+ *******************************************************************************/
+int main(void)
+{
+    test_modelTransfer();
+    test_modelArbitration();
+    test_modelFifo();
+    test_receive();
+    test_transmitAsync();
+    test_instance();
+    test_registerMap();
+    test_bitTiming();
+    test_init();
+    test_bitTimingRegisters();
+    test_allocator();
+    test_fifo();
+    test_transmitBatch();
+    test_interfaceTurn();
+    test_interfaceBusy();
+    test_update();
+    test_sendFrame();
+    test_peekFrame();
+    test_dispatch();
+    test_filter();
+    test_status();
+    test_busOff();
+    test_timestamp();
+    test_txLatency();
+    test_remote();
+    test_testMode();
+#if CAN_PROFILE
+    test_profile();
+#endif
+    printf("%s, %d failed checks\n", test_fails ? "FAILED" : "ok", test_fails);
+    return test_fails != 0;
+}
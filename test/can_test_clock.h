@@ -0,0 +1,16 @@
+/*
+ * File name: can_test_clock.h
+ *
+ *  Receive time stamps of the test builds: included ahead of every file
+ *  (see Makefile) so CAN_RX_TIMESTAMP() can be test_clock(), the bus time of
+ *  the model advanced by 1 ns on every further read at the same bus time.
+ *  Reads inside one ISR invocation then give distinct stamps.
+ */
+#ifndef CAN_TEST_CLOCK_H_
+#define CAN_TEST_CLOCK_H_
+
+#include "std_types.h"
+
+uint64 test_clock(void);
+
+#endif /* CAN_TEST_CLOCK_H_ */